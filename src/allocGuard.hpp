@@ -0,0 +1,252 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+// Debug guard against heap use on real-time threads. Built with -DALLOC_GUARD,
+// every malloc-family call (malloc, calloc, realloc, free and the aligned
+// allocators, and so every new/delete, aligned or not) on a thread that called
+// markRealtime() is counted while the guard is armed, and optionally aborts
+// with a backtrace. Off glibc only operator new/delete are hooked. Without
+// the define every call here is a no-op.
+// The allocator hooks are defined in this header, so it must only be compiled
+// into one translation unit (main.cpp).
+namespace allocGuard
+{
+#ifdef ALLOC_GUARD
+    inline std::atomic<bool> armed{false};
+    inline std::atomic<bool> abortOnHit{false};
+    inline std::atomic<size_t> hits{0};
+    inline thread_local bool realtime = false;
+    inline thread_local bool inside = false; //reporting may allocate; don't recurse.
+
+    void report(const char *what);
+
+    inline void note(const char *what)
+    {
+        if (realtime && !inside && armed.load(std::memory_order_relaxed))
+        {
+            inside = true;
+            hits.fetch_add(1, std::memory_order_relaxed);
+            if (abortOnHit.load(std::memory_order_relaxed))
+            {
+                report(what);
+            }
+            inside = false;
+        }
+    }
+#endif
+
+    constexpr bool enabled()
+    {
+#ifdef ALLOC_GUARD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Marks the calling thread as real-time (or not, e.g. before it exits);
+    // cheap enough to call per callback.
+    inline void markRealtime(bool on = true)
+    {
+#ifdef ALLOC_GUARD
+        realtime = on;
+#else
+        (void)on;
+#endif
+    }
+
+    // Starts counting, once warm-up allocations are done.
+    inline void arm(bool abortOnAlloc)
+    {
+#ifdef ALLOC_GUARD
+        abortOnHit.store(abortOnAlloc);
+        armed.store(true);
+#else
+        (void)abortOnAlloc;
+#endif
+    }
+
+    inline void disarm()
+    {
+#ifdef ALLOC_GUARD
+        armed.store(false);
+#endif
+    }
+
+    // Allocations and frees seen on real-time threads while armed.
+    inline size_t count()
+    {
+#ifdef ALLOC_GUARD
+        return hits.load();
+#else
+        return 0;
+#endif
+    }
+}
+
+#ifdef ALLOC_GUARD
+#if defined(__GLIBC__)
+#include <cerrno>
+#include <execinfo.h>
+#include <unistd.h>
+
+// glibc lets a program supply its own malloc family; forward to the real one.
+// The aligned entry points are replaced too: aligned operator new lands in
+// aligned_alloc, and glibc expects the whole family to come from one place.
+// noexcept matches glibc's own C++ declarations (__THROW), whichever header
+// declares them after this one.
+extern "C"
+{
+    void *__libc_malloc(size_t);
+    void *__libc_calloc(size_t, size_t);
+    void *__libc_realloc(void *, size_t);
+    void *__libc_memalign(size_t, size_t);
+    void *__libc_valloc(size_t);
+    void *__libc_pvalloc(size_t);
+    void __libc_free(void *);
+
+    void *malloc(size_t n) noexcept
+    {
+        allocGuard::note("malloc");
+        return __libc_malloc(n);
+    }
+
+    void *calloc(size_t n, size_t size) noexcept
+    {
+        allocGuard::note("calloc");
+        return __libc_calloc(n, size);
+    }
+
+    void *realloc(void *p, size_t n) noexcept
+    {
+        allocGuard::note("realloc");
+        return __libc_realloc(p, n);
+    }
+
+    void *memalign(size_t align, size_t n) noexcept
+    {
+        allocGuard::note("memalign");
+        return __libc_memalign(align, n);
+    }
+
+    void *aligned_alloc(size_t align, size_t n) noexcept
+    {
+        allocGuard::note("aligned_alloc");
+        return __libc_memalign(align, n);
+    }
+
+    int posix_memalign(void **out, size_t align, size_t n) noexcept
+    {
+        allocGuard::note("posix_memalign");
+        if (align == 0 || align % sizeof(void *) != 0 || (align & (align - 1)) != 0)
+        {
+            return EINVAL;
+        }
+        void *p = __libc_memalign(align, n);
+        if (p == nullptr)
+        {
+            return ENOMEM;
+        }
+        *out = p;
+        return 0;
+    }
+
+    void *valloc(size_t n) noexcept
+    {
+        allocGuard::note("valloc");
+        return __libc_valloc(n);
+    }
+
+    void *pvalloc(size_t n) noexcept
+    {
+        allocGuard::note("pvalloc");
+        return __libc_pvalloc(n);
+    }
+
+    void free(void *p) noexcept
+    {
+        if (p != nullptr)
+        {
+            allocGuard::note("free");
+        }
+        __libc_free(p);
+    }
+}
+
+inline void allocGuard::report(const char *what)
+{
+    //Straight to fd 2: stdio may allocate.
+    char msg[96];
+    int len = std::snprintf(msg, sizeof(msg), "allocGuard: %s on a real-time thread.\n", what);
+    write(2, msg, static_cast<size_t>(len));
+    void *frames[32];
+    backtrace_symbols_fd(frames, backtrace(frames, 32), 2);
+    std::abort();
+}
+#else
+#include <algorithm>
+#include <new>
+
+// No malloc hook here; catch the C++ side at least, plain and aligned. Direct
+// malloc/aligned_alloc calls from C code are not seen on these platforms.
+inline void allocGuard::report(const char *what)
+{
+    std::fprintf(stderr, "allocGuard: %s on a real-time thread.\n", what);
+    std::abort();
+}
+
+void *operator new(size_t n)
+{
+    allocGuard::note("operator new");
+    if (void *p = std::malloc(n != 0 ? n : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p != nullptr)
+    {
+        allocGuard::note("operator delete");
+    }
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+void *operator new(size_t n, std::align_val_t al)
+{
+    allocGuard::note("operator new (aligned)");
+    size_t a = static_cast<size_t>(al);
+    //aligned_alloc wants a non-zero size that is a multiple of the alignment.
+    if (void *p = std::aligned_alloc(a, (std::max<size_t>(n, 1) + a - 1) / a * a))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    if (p != nullptr)
+    {
+        allocGuard::note("operator delete (aligned)");
+    }
+    std::free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t al) noexcept
+{
+    operator delete(p, al);
+}
+#endif
+#endif
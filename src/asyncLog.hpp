@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "spscRing.hpp"
+
+// Logging for the hot thread. write() copies a format pointer and up to
+// MAX_ARGS numeric arguments into a fixed-size record in a lock-free SPSC
+// ring and returns; a background thread does the printf-style formatting and
+// the (possibly blocking) write. If the ring is full the record is dropped
+// and counted, so a stalled output never pushes back on the caller.
+// Formats must be string literals (only the pointer is queued) and may use
+// the integer and floating conversions (d i u x X f F e E g G, any length
+// modifier); one thread may write.
+struct asyncLog
+{
+    static constexpr size_t MAX_ARGS = 8;
+
+    union arg
+    {
+        double d;
+        int64_t i;
+        uint64_t u;
+    };
+
+    struct record
+    {
+        const char *fmt;
+        uint32_t nArgs;
+        arg args[MAX_ARGS];
+    };
+
+    //Set by start(), read-only afterwards.
+    std::vector<record> buf;
+    size_t cap = 0; //records, power of two.
+    size_t mask = 0;
+    std::FILE *out = nullptr;
+
+    //Writer-owned.
+    alignas(CACHE_LINE) std::atomic<size_t> w{0}; //ever-increasing.
+    size_t rCache = 0;
+    std::atomic<size_t> dropped{0}; //records lost to a full ring.
+
+    //Logger thread-owned.
+    alignas(CACHE_LINE) std::atomic<size_t> r{0}; //ever-increasing.
+    std::thread worker;
+    std::atomic<bool> running{false};
+
+    asyncLog() = default;
+    asyncLog(const asyncLog &) = delete;
+    asyncLog &operator=(const asyncLog &) = delete;
+
+    ~asyncLog()
+    {
+        stop();
+    }
+
+    // Starts the logger thread writing to dst. Room for at least records
+    // pending records, rounded up to a power of two.
+    void start(std::FILE *dst, size_t records = 1024)
+    {
+        stop();
+        cap = 1;
+        while (cap < records)
+        {
+            cap <<= 1;
+        }
+        mask = cap - 1;
+        buf.assign(cap, record{});
+        out = dst;
+        w.store(0);
+        r.store(0);
+        rCache = 0;
+        dropped.store(0);
+        running.store(true);
+        worker = std::thread([this] { run(); });
+    }
+
+    // Drains what is queued, then joins the logger thread.
+    void stop()
+    {
+        running.store(false);
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+
+    // Hot path: never blocks, never allocates. Returns false if dropped.
+    template <class... A>
+    bool write(const char *fmt, A... a)
+    {
+        static_assert(sizeof...(A) <= MAX_ARGS, "too many log arguments");
+        size_t wi = w.load(std::memory_order_relaxed);
+
+        if (wi - rCache >= cap)
+        {
+            rCache = r.load(std::memory_order_acquire);
+            if (wi - rCache >= cap)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        record &rec = buf[wi & mask];
+        rec.fmt = fmt;
+        rec.nArgs = static_cast<uint32_t>(sizeof...(A));
+        size_t k = 0;
+        (void)k;
+        ((rec.args[k++] = pack(a)), ...);
+        w.store(wi + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    template <class T>
+    static arg pack(T v)
+    {
+        static_assert(std::is_arithmetic<T>::value, "log arguments must be numbers");
+        arg x{};
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            x.d = static_cast<double>(v);
+        }
+        else if constexpr (std::is_signed<T>::value)
+        {
+            x.i = static_cast<int64_t>(v);
+        }
+        else
+        {
+            x.u = static_cast<uint64_t>(v);
+        }
+        return x;
+    }
+
+    // printf for one record: each conversion is re-emitted with a fixed
+    // 64-bit length so it matches how pack() stored the argument.
+    static size_t format(const record &rec, char *dst, size_t size)
+    {
+        size_t n = 0;
+        uint32_t next = 0;
+        const char *p = rec.fmt;
+
+        while (*p != '\0' && n + 1 < size)
+        {
+            if (*p != '%')
+            {
+                dst[n++] = *p++;
+                continue;
+            }
+            if (p[1] == '%')
+            {
+                dst[n++] = '%';
+                p += 2;
+                continue;
+            }
+
+            char spec[32] = "%";
+            size_t s = 1;
+            ++p;
+            while (*p != '\0' && std::strchr("-+ #0123456789.", *p) != nullptr && s < sizeof(spec) - 4)
+            {
+                spec[s++] = *p++;
+            }
+            while (*p != '\0' && std::strchr("hljztL", *p) != nullptr)
+            {
+                ++p; //replaced below.
+            }
+
+            char conv = *p != '\0' ? *p++ : 'd';
+            bool floating = std::strchr("fFeEgG", conv) != nullptr;
+            if (!floating)
+            {
+                spec[s++] = 'l';
+                spec[s++] = 'l';
+            }
+            spec[s++] = conv;
+            spec[s] = '\0';
+
+            int k;
+            if (next >= rec.nArgs)
+            {
+                k = std::snprintf(dst + n, size - n, "?");
+            }
+            else if (floating)
+            {
+                k = std::snprintf(dst + n, size - n, spec, rec.args[next++].d);
+            }
+            else if (conv == 'd' || conv == 'i')
+            {
+                k = std::snprintf(dst + n, size - n, spec, static_cast<long long>(rec.args[next++].i));
+            }
+            else
+            {
+                k = std::snprintf(dst + n, size - n, spec, static_cast<unsigned long long>(rec.args[next++].u));
+            }
+            n += k > 0 ? std::min(static_cast<size_t>(k), size - 1 - n) : 0;
+        }
+
+        dst[n] = '\0';
+        return n;
+    }
+
+    void run()
+    {
+        char line[512];
+        size_t reported = 0;
+
+        for (;;)
+        {
+            //Read the flag first so a final burst queued before stop() is still drained.
+            bool more = running.load(std::memory_order_acquire);
+            size_t ri = r.load(std::memory_order_relaxed);
+            size_t wi = w.load(std::memory_order_acquire);
+
+            for (; ri != wi; ri++)
+            {
+                size_t n = format(buf[ri & mask], line, sizeof(line));
+                r.store(ri + 1, std::memory_order_release); //record copied out; free the slot early.
+                std::fwrite(line, 1, n, out);
+            }
+
+            size_t lost = dropped.load(std::memory_order_relaxed);
+            if (lost != reported)
+            {
+                std::fprintf(out, "[log] %zu records dropped so far.\n", lost);
+                reported = lost;
+            }
+            std::fflush(out);
+
+            if (!more)
+            {
+                break;
+            }
+            //Not a real-time thread: a nap keeps the writer free of wakeup syscalls.
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "broadcastRing.hpp"
+#include "reblocker.hpp"
+
+// Anything that produces audio into the ring as typed planar lanes (i16, i32
+// or f32, see laneType()): the live PortAudio callback or a file reader.
+// Sources re-block through reblock, so the ring always sees full blocks
+// whatever the source's natural chunk size.
+struct audioSource
+{
+    reblocker reblock;
+
+    explicit audioSource(broadcastRing &ring) : reblock(ring) {}
+    virtual ~audioSource() = default;
+
+    // Prepares the source; sampleRate() is valid afterwards. Returns false on failure.
+    virtual bool open() = 0;
+    // Starts delivering blocks into the ring.
+    virtual bool start() = 0;
+    virtual void stop() = 0;
+    virtual double sampleRate() const = 0;
+    // Interleaved channels per frame handed to reblock; valid after open().
+    virtual size_t channelCount() const { return 1; }
+    // Ring lane type this source produces; valid after open().
+    virtual sampleType laneType() const { return sampleType::i16; }
+    // True once a finite source has committed its last block.
+    virtual bool done() const { return false; }
+    // Now on the clock Block::adcTime is measured against, in seconds.
+    virtual double streamTime() const = 0;
+};
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "spscRing.hpp"
+
+struct broadcastRing;
+
+// One consumer's view of a broadcastRing. Each reader has its own cursor on
+// its own cache line and reads slots in place; nothing is copied per reader.
+struct ringReader
+{
+    alignas(CACHE_LINE) std::atomic<size_t> r{0}; //ever-increasing.
+    size_t wCache = 0; //this reader's last look at w.
+    std::atomic<size_t> lost{0}; //blocks overwritten before this reader got to them.
+    std::atomic<size_t> torn{0}; //blocks overwritten while this reader held them.
+    broadcastRing *ring = nullptr;
+
+    const Block *peek();
+    bool release();
+    blockSpan peekBatch(size_t maxBlocks);
+    size_t releaseBatch(size_t n);
+    bool intact(size_t k) const;
+    bool waitFor(std::chrono::nanoseconds timeout);
+
+private:
+    size_t ready();
+};
+
+// Single-producer, multi-consumer broadcast ring. Slots, stamps and parking
+// are shared with spscRing (ringSlots, ringWake); "full" here means the
+// slowest reader is a ring behind, and readers registered with addReader()
+// each see every block at their own pace.
+struct broadcastRing : ringSlots
+{
+    std::vector<std::unique_ptr<ringReader>> readers; //set by addReader() before the stream starts.
+
+    //Producer-owned.
+    alignas(CACHE_LINE) std::atomic<size_t> w{0}; //ever-increasing.
+    size_t rCache = 0; //producer's last look at the slowest reader.
+    uint64_t nextSeq = 0; //Block::seq of the next claim(), dropped or not.
+    std::atomic<size_t> dropped{0}; //new blocks refused (dropNewest).
+    std::atomic<size_t> overwritten{0}; //blocks reused before the slowest reader read them (overwriteOldest).
+
+    ringWake wake;
+
+    // Same slot layout as spscRing::init(). Readers added earlier are rewound.
+    void init(size_t framesPerBlock, size_t nChannels = 1, sampleType t = sampleType::i16,
+              overflowPolicy p = overflowPolicy::dropNewest)
+    {
+        initSlots(framesPerBlock, nChannels, t, p);
+        w.store(0);
+        rCache = 0;
+        nextSeq = 0;
+        dropped.store(0);
+        overwritten.store(0);
+        for (auto &rd : readers)
+        {
+            rd->r.store(0);
+            rd->wCache = 0;
+            rd->lost.store(0);
+            rd->torn.store(0);
+        }
+    }
+
+    // Registers a consumer. Must run before the stream starts; the reference
+    // stays valid for the ring's lifetime.
+    ringReader &addReader()
+    {
+        readers.push_back(std::make_unique<ringReader>());
+        ringReader &rd = *readers.back();
+        rd.ring = this;
+        rd.r.store(w.load());
+        rd.wCache = rd.r.load();
+        return rd;
+    }
+
+    // Producer: reserve the next slot to fill in place. Under dropNewest this
+    // returns nullptr (and counts a drop) while any reader is a ring behind;
+    // under overwriteOldest it always succeeds and the oldest slot is reused.
+    // Every call takes a sequence number, so readers see drops as seq gaps.
+    // The caller sets adcTime and statusFlags before commit().
+    Block *claim()
+    {
+        size_t wi = w.load(std::memory_order_relaxed);
+        uint64_t s = nextSeq++;
+
+        if (full())
+        {
+            if (policy == overflowPolicy::dropNewest)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            overwritten.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Block &b = beginWrite(wi);
+        b.seq = s;
+        b.adcTime = 0.0;
+        b.statusFlags = 0;
+        return &b;
+    }
+
+    // Producer: publish the slot handed out by the last claim(). The fill it
+    // records is the true queue depth behind the slowest reader: one acquire
+    // load per reader, small next to a block's worth of audio.
+    void commit()
+    {
+        size_t wi = w.load(std::memory_order_relaxed);
+        rCache = slowest(wi);
+        buf[wi & mask].fill = static_cast<uint32_t>(std::min(wi + 1 - rCache, cap));
+        endWrite(wi);
+        w.store(wi + 1, std::memory_order_release);
+        wake.notify();
+    }
+
+    // Producer: true if the slowest reader is a whole ring behind, i.e. the
+    // next claim() would drop or overwrite a block someone has not read.
+    bool full()
+    {
+        size_t wi = w.load(std::memory_order_relaxed);
+        if (wi - rCache >= cap)
+        {
+            rCache = slowest(wi);
+        }
+        return wi - rCache >= cap;
+    }
+
+    // Kick every parked reader without publishing a slot, e.g. at end of stream.
+    void wakeReaders()
+    {
+        wake.wakeAll();
+    }
+
+private:
+    size_t slowest(size_t wi) const
+    {
+        size_t lo = wi;
+        for (const auto &rd : readers)
+        {
+            size_t ri = rd->r.load(std::memory_order_acquire);
+            if (wi - ri > wi - lo)
+            {
+                lo = ri;
+            }
+        }
+        return lo;
+    }
+};
+
+// Blocks ready for this reader. A reader lapped by more than a ring first
+// skips to the oldest block that can still be intact, counting the rest as lost.
+inline size_t ringReader::ready()
+{
+    size_t ri = r.load(std::memory_order_relaxed);
+    if (ri == wCache)
+    {
+        wCache = ring->w.load(std::memory_order_acquire);
+    }
+
+    if (ring->policy == overflowPolicy::overwriteOldest && wCache - ri > ring->cap)
+    {
+        size_t oldest = wCache - ring->cap;
+        lost.fetch_add(oldest - ri, std::memory_order_relaxed);
+        r.store(oldest, std::memory_order_release);
+        ri = oldest;
+    }
+    return wCache - ri;
+}
+
+// Consumer: look at this reader's oldest unread slot; valid until release().
+inline const Block *ringReader::peek()
+{
+    if (ready() == 0)
+    {
+        return nullptr;
+    }
+    return &ring->buf[r.load(std::memory_order_relaxed) & ring->mask];
+}
+
+// Consumer: done with the slot from peek(). Returns false if the producer
+// overwrote it while it was held (overwriteOldest only).
+inline bool ringReader::release()
+{
+    return releaseBatch(1) == 0;
+}
+
+// Consumer: up to maxBlocks unread slots as one or two contiguous spans.
+inline blockSpan ringReader::peekBatch(size_t maxBlocks)
+{
+    size_t n = std::min(ready(), maxBlocks);
+    return ring->span(r.load(std::memory_order_relaxed), n);
+}
+
+// Consumer: hand back n slots with a single index store. Returns how many of
+// them the producer overwrote while they were held; always 0 under dropNewest.
+inline size_t ringReader::releaseBatch(size_t n)
+{
+    size_t ri = r.load(std::memory_order_relaxed);
+    size_t bad = ring->tornIn(ri, n);
+    torn.fetch_add(bad, std::memory_order_relaxed);
+    r.store(ri + n, std::memory_order_release);
+    return bad;
+}
+
+// Consumer: true while the k-th slot of the current batch still holds the
+// block peekBatch() handed out; always true under dropNewest.
+inline bool ringReader::intact(size_t k) const
+{
+    return ring->intact(r.load(std::memory_order_relaxed) + k);
+}
+
+// Consumer: block until a slot is ready for this reader or the timeout expires.
+inline bool ringReader::waitFor(std::chrono::nanoseconds timeout)
+{
+    return ring->wake.wait(
+        [this] { return ring->w.load(std::memory_order_acquire) != r.load(std::memory_order_relaxed); }, timeout);
+}
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define DEINTERLEAVE_SSE2 1
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define DEINTERLEAVE_NEON 1
+#endif
+
+// Interleaved frames to planar lanes: lane c starts at dst + c * stride.
+// For int16, 2, 4, 8 and 16 channels take an 8-frame SIMD transpose; 32-bit
+// samples (int32 and float bit patterns alike) take a 4-frame transpose for
+// 2 channels and 4x4 tiles for any multiple of 4. Other counts and leftover
+// frames use the scalar loop.
+// Packed 24-bit input is first widened to 32-bit words (SSSE3 byte shuffle
+// or NEON byte-plane loads) and then takes the 32-bit path.
+namespace deinterleave
+{
+    template <class T>
+    inline void scalar(const T *src, size_t channels, size_t frames, T *dst, size_t stride)
+    {
+        for (size_t i = 0; i < frames; i++)
+        {
+            for (size_t c = 0; c < channels; c++)
+            {
+                dst[c * stride + i] = src[i * channels + c];
+            }
+        }
+    }
+
+#ifdef DEINTERLEAVE_SSE2
+    // 8x8 int16 transpose: r[f] holds frame f's 8 channels on entry, channel f's 8 frames on exit.
+    inline void transpose8(__m128i r[8])
+    {
+        __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+        __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+        __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+        __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+        __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+        __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+        __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+        __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+        __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+        __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+        __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+        __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+        __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+        __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+        __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+        __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+        r[0] = _mm_unpacklo_epi64(b0, b4);
+        r[1] = _mm_unpackhi_epi64(b0, b4);
+        r[2] = _mm_unpacklo_epi64(b1, b5);
+        r[3] = _mm_unpackhi_epi64(b1, b5);
+        r[4] = _mm_unpacklo_epi64(b2, b6);
+        r[5] = _mm_unpackhi_epi64(b2, b6);
+        r[6] = _mm_unpacklo_epi64(b3, b7);
+        r[7] = _mm_unpackhi_epi64(b3, b7);
+    }
+
+    inline __m128i load(const int16_t *p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    }
+
+    inline void store(int16_t *p, __m128i v)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+    }
+#endif
+
+    inline void run(const int16_t *src, size_t channels, size_t frames, int16_t *dst, size_t stride)
+    {
+        if (channels == 1)
+        {
+            for (size_t i = 0; i < frames; i++)
+            {
+                dst[i] = src[i];
+            }
+            return;
+        }
+
+        size_t i = 0;
+
+#ifdef DEINTERLEAVE_SSE2
+        if (channels == 2)
+        {
+            for (; i + 8 <= frames; i += 8)
+            {
+                const int16_t *s = src + i * 2;
+                __m128i a = load(s);
+                __m128i b = load(s + 8);
+                __m128i t0 = _mm_unpacklo_epi16(a, b);
+                __m128i t1 = _mm_unpackhi_epi16(a, b);
+                __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+                __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+                store(dst + i, _mm_unpacklo_epi16(u0, u1));
+                store(dst + stride + i, _mm_unpackhi_epi16(u0, u1));
+            }
+        }
+        else if (channels == 4)
+        {
+            for (; i + 8 <= frames; i += 8)
+            {
+                const int16_t *s = src + i * 4;
+                __m128i a = load(s);
+                __m128i b = load(s + 8);
+                __m128i c = load(s + 16);
+                __m128i d = load(s + 24);
+                __m128i t0 = _mm_unpacklo_epi16(a, b);
+                __m128i t1 = _mm_unpackhi_epi16(a, b);
+                __m128i t2 = _mm_unpacklo_epi16(c, d);
+                __m128i t3 = _mm_unpackhi_epi16(c, d);
+                __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+                __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+                __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+                __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+                store(dst + i, _mm_unpacklo_epi64(u0, u2));
+                store(dst + stride + i, _mm_unpackhi_epi64(u0, u2));
+                store(dst + 2 * stride + i, _mm_unpacklo_epi64(u1, u3));
+                store(dst + 3 * stride + i, _mm_unpackhi_epi64(u1, u3));
+            }
+        }
+        else if (channels == 8 || channels == 16)
+        {
+            for (; i + 8 <= frames; i += 8)
+            {
+                //16 channels are two independent 8x8 tiles per 8 frames.
+                for (size_t g = 0; g < channels; g += 8)
+                {
+                    __m128i r[8];
+                    for (size_t f = 0; f < 8; f++)
+                    {
+                        r[f] = load(src + (i + f) * channels + g);
+                    }
+                    transpose8(r);
+                    for (size_t c = 0; c < 8; c++)
+                    {
+                        store(dst + (g + c) * stride + i, r[c]);
+                    }
+                }
+            }
+        }
+#elif defined(DEINTERLEAVE_NEON)
+        if (channels == 2)
+        {
+            for (; i + 8 <= frames; i += 8)
+            {
+                int16x8x2_t v = vld2q_s16(src + i * 2);
+                vst1q_s16(dst + i, v.val[0]);
+                vst1q_s16(dst + stride + i, v.val[1]);
+            }
+        }
+        else if (channels == 4)
+        {
+            for (; i + 8 <= frames; i += 8)
+            {
+                int16x8x4_t v = vld4q_s16(src + i * 4);
+                for (size_t c = 0; c < 4; c++)
+                {
+                    vst1q_s16(dst + c * stride + i, v.val[c]);
+                }
+            }
+        }
+#endif
+
+        scalar(src + i * channels, channels, frames - i, dst + i, stride);
+    }
+
+    inline void run32(const uint32_t *src, size_t channels, size_t frames, uint32_t *dst, size_t stride)
+    {
+        size_t i = 0;
+
+#ifdef DEINTERLEAVE_SSE2
+        if (channels == 2)
+        {
+            for (; i + 4 <= frames; i += 4)
+            {
+                __m128 a = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2)));
+                __m128 b = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2 + 4)));
+                _mm_storeu_ps(reinterpret_cast<float *>(dst + i), _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_storeu_ps(reinterpret_cast<float *>(dst + stride + i), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            }
+        }
+        else if (channels % 4 == 0)
+        {
+            for (; i + 4 <= frames; i += 4)
+            {
+                //Each group of 4 channels over 4 frames is an independent 4x4 tile.
+                for (size_t g = 0; g < channels; g += 4)
+                {
+                    const float *s = reinterpret_cast<const float *>(src + i * channels + g);
+                    __m128 r0 = _mm_loadu_ps(s);
+                    __m128 r1 = _mm_loadu_ps(s + channels);
+                    __m128 r2 = _mm_loadu_ps(s + 2 * channels);
+                    __m128 r3 = _mm_loadu_ps(s + 3 * channels);
+                    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                    float *d = reinterpret_cast<float *>(dst + g * stride + i);
+                    _mm_storeu_ps(d, r0);
+                    _mm_storeu_ps(d + stride, r1);
+                    _mm_storeu_ps(d + 2 * stride, r2);
+                    _mm_storeu_ps(d + 3 * stride, r3);
+                }
+            }
+        }
+#elif defined(DEINTERLEAVE_NEON)
+        if (channels == 2)
+        {
+            for (; i + 4 <= frames; i += 4)
+            {
+                uint32x4x2_t v = vld2q_u32(src + i * 2);
+                vst1q_u32(dst + i, v.val[0]);
+                vst1q_u32(dst + stride + i, v.val[1]);
+            }
+        }
+        else if (channels == 4)
+        {
+            for (; i + 4 <= frames; i += 4)
+            {
+                uint32x4x4_t v = vld4q_u32(src + i * 4);
+                for (size_t c = 0; c < 4; c++)
+                {
+                    vst1q_u32(dst + c * stride + i, v.val[c]);
+                }
+            }
+        }
+        else if (channels % 4 == 0)
+        {
+            for (; i + 4 <= frames; i += 4)
+            {
+                for (size_t g = 0; g < channels; g += 4)
+                {
+                    const uint32_t *p = src + i * channels + g;
+                    uint32x4x2_t t01 = vtrnq_u32(vld1q_u32(p), vld1q_u32(p + channels));
+                    uint32x4x2_t t23 = vtrnq_u32(vld1q_u32(p + 2 * channels), vld1q_u32(p + 3 * channels));
+                    uint32_t *d = dst + g * stride + i;
+                    vst1q_u32(d, vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0])));
+                    vst1q_u32(d + stride, vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1])));
+                    vst1q_u32(d + 2 * stride, vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0])));
+                    vst1q_u32(d + 3 * stride, vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1])));
+                }
+            }
+        }
+#endif
+
+        scalar(src + i * channels, channels, frames - i, dst + i, stride);
+    }
+
+    // Packed little-endian 24-bit samples to left-justified 32-bit words:
+    // each 3 bytes b0 b1 b2 become the word b0 << 8 | b1 << 16 | b2 << 24.
+    inline void widen24Scalar(const unsigned char *src, size_t n, uint32_t *dst)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            const unsigned char *p = src + 3 * i;
+            dst[i] = (static_cast<uint32_t>(p[0]) << 8) | (static_cast<uint32_t>(p[1]) << 16) |
+                     (static_cast<uint32_t>(p[2]) << 24);
+        }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    // Four samples per byte shuffle; each 16-byte load uses 12 of its bytes.
+    __attribute__((target("ssse3")))
+    inline void widen24Ssse3(const unsigned char *src, size_t n, uint32_t *dst)
+    {
+        const __m128i spread = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+        size_t i = 0;
+        //Stop while a full 16-byte load still fits inside the 3n input bytes.
+        for (; i + 6 <= n; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3 * i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_shuffle_epi8(v, spread));
+        }
+        widen24Scalar(src + 3 * i, n - i, dst + i);
+    }
+#endif
+
+    inline void widen24(const unsigned char *src, size_t n, uint32_t *dst)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        static const bool ssse3 = __builtin_cpu_supports("ssse3");
+        if (ssse3)
+        {
+            widen24Ssse3(src, n, dst);
+            return;
+        }
+#elif defined(DEINTERLEAVE_NEON)
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            //Split 16 samples into byte planes, then re-interleave with a zero low byte.
+            uint8x16x3_t b = vld3q_u8(src + 3 * i);
+            uint8x16x4_t w = {{vdupq_n_u8(0), b.val[0], b.val[1], b.val[2]}};
+            vst4q_u8(reinterpret_cast<uint8_t *>(dst + i), w);
+        }
+        src += 3 * i;
+        dst += i;
+        n -= i;
+#endif
+        widen24Scalar(src, n, dst);
+    }
+
+    // Packed little-endian 24-bit frames to left-justified int32 lanes, so
+    // they share the int32 path downstream: widened a chunk at a time into a
+    // stack buffer, then split by the 32-bit transposes.
+    inline void run24(const unsigned char *src, size_t channels, size_t frames, int32_t *dst, size_t stride)
+    {
+        constexpr size_t CHUNK = 512; //samples.
+        uint32_t tmp[CHUNK];
+        uint32_t *out = reinterpret_cast<uint32_t *>(dst);
+        if (channels == 1)
+        {
+            widen24(src, frames, out);
+            return;
+        }
+        size_t per = channels <= CHUNK ? CHUNK / channels : 0;
+        if (per == 0)
+        {
+            for (size_t i = 0; i < frames; i++)
+            {
+                for (size_t c = 0; c < channels; c++)
+                {
+                    widen24Scalar(src + 3 * (i * channels + c), 1, out + c * stride + i);
+                }
+            }
+            return;
+        }
+
+        for (size_t i = 0; i < frames; i += per)
+        {
+            size_t k = frames - i < per ? frames - i : per;
+            widen24(src + 3 * i * channels, k * channels, tmp);
+            run32(tmp, channels, k, out + i, stride);
+        }
+    }
+}
@@ -0,0 +1,389 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FFT_SSE2 1
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define FFT_NEON 1
+#endif
+
+// Real-input FFT for frame sizes whose half has only the factors 2, 3 and 5
+// (256, 400, 480, 512, 1000, ...). The real frame is packed into a complex
+// sequence of half the length, transformed by a mixed radix 4/2/3/5 Stockham
+// FFT (self-sorting, no bit reversal) and split into n/2 + 1 bins. Data is
+// kept as separate re/im arrays so butterflies over neighbouring
+// sub-transforms run four at a time in SIMD registers.
+namespace fft
+{
+    constexpr double PI = 3.14159265358979323846;
+
+    // Four floats, or one when there is no SIMD; just enough arithmetic for a butterfly.
+    struct vec4
+    {
+#if defined(FFT_SSE2)
+        static constexpr size_t WIDTH = 4;
+        __m128 v;
+        static vec4 load(const float *p) { return {_mm_loadu_ps(p)}; }
+        static vec4 set(float x) { return {_mm_set1_ps(x)}; }
+        void store(float *p) const { _mm_storeu_ps(p, v); }
+        friend vec4 operator+(vec4 a, vec4 b) { return {_mm_add_ps(a.v, b.v)}; }
+        friend vec4 operator-(vec4 a, vec4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+        friend vec4 operator*(vec4 a, vec4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+        static void transpose(vec4 &a, vec4 &b, vec4 &c, vec4 &d) { _MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v); }
+#elif defined(FFT_NEON)
+        static constexpr size_t WIDTH = 4;
+        float32x4_t v;
+        static vec4 load(const float *p) { return {vld1q_f32(p)}; }
+        static vec4 set(float x) { return {vdupq_n_f32(x)}; }
+        void store(float *p) const { vst1q_f32(p, v); }
+        friend vec4 operator+(vec4 a, vec4 b) { return {vaddq_f32(a.v, b.v)}; }
+        friend vec4 operator-(vec4 a, vec4 b) { return {vsubq_f32(a.v, b.v)}; }
+        friend vec4 operator*(vec4 a, vec4 b) { return {vmulq_f32(a.v, b.v)}; }
+        static void transpose(vec4 &a, vec4 &b, vec4 &c, vec4 &d)
+        {
+            float32x4x2_t ab = vtrnq_f32(a.v, b.v);
+            float32x4x2_t cd = vtrnq_f32(c.v, d.v);
+            a.v = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+            b.v = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+            c.v = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+            d.v = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+        }
+#else
+        static constexpr size_t WIDTH = 1;
+        float v;
+        static vec4 load(const float *p) { return {*p}; }
+        static vec4 set(float x) { return {x}; }
+        void store(float *p) const { *p = v; }
+        friend vec4 operator+(vec4 a, vec4 b) { return {a.v + b.v}; }
+        friend vec4 operator-(vec4 a, vec4 b) { return {a.v - b.v}; }
+        friend vec4 operator*(vec4 a, vec4 b) { return {a.v * b.v}; }
+#endif
+    };
+
+    // One lane, same interface, for the leftovers.
+    struct vec1
+    {
+        static constexpr size_t WIDTH = 1;
+        float v;
+        static vec1 load(const float *p) { return {*p}; }
+        static vec1 set(float x) { return {x}; }
+        void store(float *p) const { *p = v; }
+        friend vec1 operator+(vec1 a, vec1 b) { return {a.v + b.v}; }
+        friend vec1 operator-(vec1 a, vec1 b) { return {a.v - b.v}; }
+        friend vec1 operator*(vec1 a, vec1 b) { return {a.v * b.v}; }
+    };
+
+    template <class V>
+    struct cpx
+    {
+        V re, im;
+        friend cpx operator+(cpx a, cpx b) { return {a.re + b.re, a.im + b.im}; }
+        friend cpx operator-(cpx a, cpx b) { return {a.re - b.re, a.im - b.im}; }
+        cpx scale(V k) const { return {re * k, im * k}; }
+        cpx mulNegI() const { return {im, V{} - re}; } //-i * z
+        cpx mul(V wr, V wi) const { return {re * wr - im * wi, re * wi + im * wr}; }
+    };
+
+    // Forward DFT of R points in place: a[j] = sum_k a[k] e^(-2 pi i jk/R).
+    template <int R, class V>
+    inline void butterfly(cpx<V> *a)
+    {
+        if constexpr (R == 2)
+        {
+            cpx<V> t = a[0] - a[1];
+            a[0] = a[0] + a[1];
+            a[1] = t;
+        }
+        else if constexpr (R == 4)
+        {
+            cpx<V> t0 = a[0] + a[2];
+            cpx<V> t1 = a[0] - a[2];
+            cpx<V> t2 = a[1] + a[3];
+            cpx<V> t3 = (a[1] - a[3]).mulNegI();
+            a[0] = t0 + t2;
+            a[1] = t1 + t3;
+            a[2] = t0 - t2;
+            a[3] = t1 - t3;
+        }
+        else if constexpr (R == 3)
+        {
+            const V c = V::set(-0.5f);
+            const V s = V::set(0.86602540378443865f);
+            cpx<V> t1 = a[1] + a[2];
+            cpx<V> t2 = a[0] + t1.scale(c);
+            cpx<V> t3 = (a[1] - a[2]).scale(s).mulNegI();
+            a[0] = a[0] + t1;
+            a[1] = t2 + t3;
+            a[2] = t2 - t3;
+        }
+        else
+        {
+            static_assert(R == 5, "radix 2, 3, 4 or 5");
+            const V c1 = V::set(0.30901699437494742f);
+            const V c2 = V::set(-0.80901699437494742f);
+            const V s1 = V::set(0.95105651629515357f);
+            const V s2 = V::set(0.58778525229247313f);
+            cpx<V> b1 = a[1] + a[4];
+            cpx<V> b2 = a[2] + a[3];
+            cpx<V> d1 = a[1] - a[4];
+            cpx<V> d2 = a[2] - a[3];
+            cpx<V> t1 = a[0] + b1.scale(c1) + b2.scale(c2);
+            cpx<V> t2 = a[0] + b1.scale(c2) + b2.scale(c1);
+            cpx<V> u1 = (d1.scale(s1) + d2.scale(s2)).mulNegI();
+            cpx<V> u2 = (d1.scale(s2) - d2.scale(s1)).mulNegI();
+            a[0] = a[0] + b1 + b2;
+            a[1] = t1 + u1;
+            a[4] = t1 - u1;
+            a[2] = t2 + u2;
+            a[3] = t2 - u2;
+        }
+    }
+
+    // s sub-transforms of length n, interleaved with stride s, one radix-R step:
+    // y[q + s(Rp + j)] = w^(jp) * DFT_R(x[q + s(p + km)])_j, w = e^(-2 pi i/n), m = n/R.
+    // Twiddles are laid out j-major: w^(jp) at tw[(j - 1) * m + p].
+    template <int R, class V>
+    inline void butterflies(const float *xr, const float *xi, float *yr, float *yi, size_t q, size_t s, size_t p,
+                            size_t m, const float *twr, const float *twi)
+    {
+        cpx<V> a[R];
+        for (int k = 0; k < R; k++)
+        {
+            size_t at = q + s * (p + k * m);
+            a[k] = {V::load(xr + at), V::load(xi + at)};
+        }
+        butterfly<R>(a);
+        for (int j = 0; j < R; j++)
+        {
+            size_t t = (j - 1) * m + p;
+            cpx<V> y = j == 0 ? a[0] : a[j].mul(V::set(twr[t]), V::set(twi[t]));
+            size_t at = q + s * (R * p + j);
+            y.re.store(yr + at);
+            y.im.store(yi + at);
+        }
+    }
+
+#if defined(FFT_SSE2) || defined(FFT_NEON)
+    // First radix-4 stage (s == 1): the q loop is one wide, so run four p at
+    // once instead and transpose the outputs back into place. SIMD builds only:
+    // the scalar vec4 has no transpose.
+    inline void firstPass4(const float *xr, const float *xi, float *yr, float *yi, size_t m, const float *twr,
+                           const float *twi)
+    {
+        for (size_t p = 0; p < m; p += 4)
+        {
+            cpx<vec4> a[4];
+            for (size_t k = 0; k < 4; k++)
+            {
+                a[k] = {vec4::load(xr + p + k * m), vec4::load(xi + p + k * m)};
+            }
+            butterfly<4>(a);
+            for (size_t j = 1; j < 4; j++)
+            {
+                a[j] = a[j].mul(vec4::load(twr + (j - 1) * m + p), vec4::load(twi + (j - 1) * m + p));
+            }
+            vec4::transpose(a[0].re, a[1].re, a[2].re, a[3].re);
+            vec4::transpose(a[0].im, a[1].im, a[2].im, a[3].im);
+            for (size_t k = 0; k < 4; k++)
+            {
+                a[k].re.store(yr + 4 * (p + k));
+                a[k].im.store(yi + 4 * (p + k));
+            }
+        }
+    }
+#endif
+
+    template <int R>
+    inline void pass(const float *xr, const float *xi, float *yr, float *yi, size_t n, size_t s, const float *twr,
+                     const float *twi)
+    {
+        const size_t m = n / R;
+#if defined(FFT_SSE2) || defined(FFT_NEON)
+        if constexpr (R == 4)
+        {
+            if (s == 1 && m % 4 == 0)
+            {
+                firstPass4(xr, xi, yr, yi, m, twr, twi);
+                return;
+            }
+        }
+#endif
+
+        for (size_t p = 0; p < m; p++)
+        {
+            size_t q = 0;
+            for (; q + vec4::WIDTH <= s; q += vec4::WIDTH)
+            {
+                butterflies<R, vec4>(xr, xi, yr, yi, q, s, p, m, twr, twi);
+            }
+            for (; q < s; q++)
+            {
+                butterflies<R, vec1>(xr, xi, yr, yi, q, s, p, m, twr, twi);
+            }
+        }
+    }
+}
+
+// Plan for one real frame size: factorisation, every stage's twiddles, the
+// split twiddles and work buffers, all allocated by init(). forward() itself
+// allocates nothing.
+struct realFft
+{
+    struct stage
+    {
+        int radix;
+        size_t n; //sub-transform length entering this stage.
+        size_t s; //number of interleaved sub-transforms.
+        size_t tw; //offset of its twiddles in twr/twi.
+    };
+
+    size_t n = 0; //real frame length.
+    size_t half = 0; //complex length, n/2.
+    std::vector<stage> stages;
+    std::vector<float> twr, twi; //per stage: w^(jp) for 1 <= j < radix, p < m, j-major.
+    std::vector<float> splitR, splitI; //e^(-2 pi i k/n) for k <= n/2.
+    std::vector<float> ar, ai, br, bi; //ping-pong buffers, half each.
+
+    // True if n is even and n/2 factors into 2, 3 and 5.
+    static bool supported(size_t n)
+    {
+        if (n < 4 || n % 2 != 0)
+        {
+            return false;
+        }
+        size_t m = n / 2;
+        for (size_t f : {2, 3, 5})
+        {
+            while (m % f == 0)
+            {
+                m /= f;
+            }
+        }
+        return m == 1;
+    }
+
+    bool init(size_t frameSize)
+    {
+        if (!supported(frameSize))
+        {
+            return false;
+        }
+
+        n = frameSize;
+        half = n / 2;
+        stages.clear();
+        twr.clear();
+        twi.clear();
+
+        //Radix 4 first: the stride grows fastest, so more stages run four wide.
+        size_t len = half;
+        size_t s = 1;
+        for (int r : {4, 2, 3, 5})
+        {
+            while (len % r == 0)
+            {
+                stages.push_back({r, len, s, twr.size()});
+                size_t m = len / r;
+                for (int j = 1; j < r; j++)
+                {
+                    for (size_t p = 0; p < m; p++)
+                    {
+                        double a = -2.0 * fft::PI * static_cast<double>(j * p) / static_cast<double>(len);
+                        twr.push_back(static_cast<float>(std::cos(a)));
+                        twi.push_back(static_cast<float>(std::sin(a)));
+                    }
+                }
+                len = m;
+                s *= r;
+            }
+        }
+
+        splitR.resize(half + 1);
+        splitI.resize(half + 1);
+        for (size_t k = 0; k <= half; k++)
+        {
+            double a = -2.0 * fft::PI * static_cast<double>(k) / static_cast<double>(n);
+            splitR[k] = static_cast<float>(std::cos(a));
+            splitI[k] = static_cast<float>(std::sin(a));
+        }
+
+        ar.assign(half, 0.0f);
+        ai.assign(half, 0.0f);
+        br.assign(half, 0.0f);
+        bi.assign(half, 0.0f);
+        return true;
+    }
+
+    // n real samples in, n/2 + 1 bins out (DC to Nyquist), unnormalised.
+    void forward(const float *in, float *re, float *im)
+    {
+        //Even samples to the real part, odd ones to the imaginary part.
+        for (size_t k = 0; k < half; k++)
+        {
+            ar[k] = in[2 * k];
+            ai[k] = in[2 * k + 1];
+        }
+
+        float *xr = ar.data(), *xi = ai.data(), *yr = br.data(), *yi = bi.data();
+        for (const stage &st : stages)
+        {
+            const float *wr = twr.data() + st.tw;
+            const float *wi = twi.data() + st.tw;
+            switch (st.radix)
+            {
+            case 4: fft::pass<4>(xr, xi, yr, yi, st.n, st.s, wr, wi); break;
+            case 2: fft::pass<2>(xr, xi, yr, yi, st.n, st.s, wr, wi); break;
+            case 3: fft::pass<3>(xr, xi, yr, yi, st.n, st.s, wr, wi); break;
+            default: fft::pass<5>(xr, xi, yr, yi, st.n, st.s, wr, wi); break;
+            }
+            std::swap(xr, yr);
+            std::swap(xi, yi);
+        }
+
+        //Z = FFT(z); X[k] = (Z[k] + conj Z[h-k])/2 - i/2 e^(-2 pi i k/n) (Z[k] - conj Z[h-k]).
+        for (size_t k = 0; k <= half; k++)
+        {
+            size_t a = k % half;
+            size_t b = (half - k) % half;
+            float er = 0.5f * (xr[a] + xr[b]);
+            float ei = 0.5f * (xi[a] - xi[b]);
+            float orr = 0.5f * (xi[a] + xi[b]);
+            float oi = -0.5f * (xr[a] - xr[b]);
+            re[k] = er + orr * splitR[k] - oi * splitI[k];
+            im[k] = ei + orr * splitI[k] + oi * splitR[k];
+        }
+    }
+};
+
+namespace fft
+{
+    // Shared plan for frame size n, built on first use and reused after that;
+    // nullptr if the size is unsupported. Not thread-safe: fetch plans before
+    // the processing loop starts, then keep the pointer.
+    inline realFft *plan(size_t n)
+    {
+        static std::vector<std::unique_ptr<realFft>> cache;
+        for (const auto &p : cache)
+        {
+            if (p->n == n)
+            {
+                return p.get();
+            }
+        }
+
+        auto p = std::make_unique<realFft>();
+        if (!p->init(n))
+        {
+            return nullptr;
+        }
+        cache.push_back(std::move(p));
+        return cache.back().get();
+    }
+}
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "allocGuard.hpp"
+#include "audioSource.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FILE_SOURCE_MMAP 1
+#endif
+
+// Reads 16-bit PCM from a WAV file (or headerless raw PCM at a given rate and channel count)
+// on its own thread. Paced mode delivers blocks at the file's real-time rate;
+// unpaced mode delivers as fast as the consumer drains the ring, never dropping.
+// Mono files are memory-mapped and ring slots point straight into the mapping,
+// so only the final partial block is ever copied; multi-channel files are read
+// and deinterleaved by the reblocker.
+struct fileSource : audioSource
+{
+    std::string path;
+    bool raw = false;
+    bool paced = true;
+    double fs = 0.0;
+    int channels = 1;
+    long dataOffset = 0;
+    uint64_t dataBytes = 0;
+
+    std::FILE *fp = nullptr;
+    const unsigned char *map = nullptr; //whole file, read-only.
+    size_t mapBytes = 0;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<bool> finished{false};
+    std::chrono::steady_clock::time_point t0; //stream clock origin, set by start().
+    std::vector<int16_t> chunk; //one block of interleaved frames for run(), sized by start().
+
+    fileSource(broadcastRing &ring, std::string file, bool rawPcm, double rawRate, int rawChannels, bool realTime)
+        : audioSource(ring), path(std::move(file)), raw(rawPcm), paced(realTime), fs(rawRate), channels(rawChannels) {}
+
+    ~fileSource() override
+    {
+        stop();
+#ifdef FILE_SOURCE_MMAP
+        if (map != nullptr)
+        {
+            munmap(const_cast<unsigned char *>(map), mapBytes);
+        }
+#endif
+        if (fp != nullptr)
+        {
+            std::fclose(fp);
+        }
+    }
+
+    bool open() override
+    {
+        fp = std::fopen(path.c_str(), "rb");
+        if (fp == nullptr)
+        {
+            std::fprintf(stderr, "Could not open %s.\n", path.c_str());
+            return false;
+        }
+
+        if (raw)
+        {
+            std::fseek(fp, 0, SEEK_END);
+            dataBytes = static_cast<uint64_t>(std::ftell(fp));
+            dataOffset = 0;
+            if (fs <= 0)
+            {
+                std::fprintf(stderr, "%s: raw input has no header; give its rate with --rate.\n", path.c_str());
+                return false;
+            }
+        }
+        else if (!parseWav())
+        {
+            return false;
+        }
+
+        if (channels == 1)
+        {
+            mapFile(); //falls back to buffered reads if this fails.
+        }
+        reblock.rate = fs;
+        return true;
+    }
+
+    bool start() override
+    {
+        std::fseek(fp, dataOffset, SEEK_SET);
+        chunk.assign(reblock.rb.frames * channels, 0); //allocated here, not on the worker.
+        running.store(true);
+        t0 = std::chrono::steady_clock::now();
+        worker = std::thread([this]
+        {
+            allocGuard::markRealtime(); //stands in for the audio callback thread.
+            map != nullptr ? runMapped() : run();
+            allocGuard::markRealtime(false); //thread teardown frees.
+        });
+        return true;
+    }
+
+    void stop() override
+    {
+        running.store(false);
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+
+    double sampleRate() const override
+    {
+        return fs;
+    }
+
+    size_t channelCount() const override
+    {
+        return static_cast<size_t>(channels);
+    }
+
+    bool done() const override
+    {
+        return finished.load(std::memory_order_acquire);
+    }
+
+    // Seconds since start(); a paced file's frame k is "captured" at k / fs.
+    double streamTime() const override
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+private:
+    static uint32_t le32(const unsigned char *p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    static uint16_t le16(const unsigned char *p)
+    {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    // Walks the RIFF chunks for "fmt " and "data".
+    bool parseWav()
+    {
+        unsigned char hdr[12];
+        if (std::fread(hdr, 1, 12, fp) != 12 || std::memcmp(hdr, "RIFF", 4) != 0 || std::memcmp(hdr + 8, "WAVE", 4) != 0)
+        {
+            std::fprintf(stderr, "%s is not a RIFF/WAVE file.\n", path.c_str());
+            return false;
+        }
+
+        bool haveFmt = false;
+        unsigned char ck[8];
+        while (std::fread(ck, 1, 8, fp) == 8)
+        {
+            uint32_t size = le32(ck + 4);
+
+            if (std::memcmp(ck, "fmt ", 4) == 0)
+            {
+                unsigned char f[16];
+                if (size < 16 || std::fread(f, 1, 16, fp) != 16)
+                {
+                    break;
+                }
+
+                uint16_t format = le16(f);
+                channels = le16(f + 2);
+                fs = le32(f + 4);
+                uint16_t bits = le16(f + 14);
+
+                //1 = PCM, 0xFFFE = WAVE_FORMAT_EXTENSIBLE.
+                if ((format != 1 && format != 0xFFFE) || bits != 16 || channels < 1)
+                {
+                    std::fprintf(stderr, "%s: only 16-bit PCM WAV is supported.\n", path.c_str());
+                    return false;
+                }
+
+                haveFmt = true;
+                std::fseek(fp, static_cast<long>(size - 16 + (size & 1)), SEEK_CUR);
+            }
+            else if (std::memcmp(ck, "data", 4) == 0)
+            {
+                if (!haveFmt)
+                {
+                    break;
+                }
+                dataOffset = std::ftell(fp);
+                dataBytes = size;
+                return true;
+            }
+            else
+            {
+                std::fseek(fp, static_cast<long>(size + (size & 1)), SEEK_CUR); //chunks are word aligned.
+            }
+        }
+
+        std::fprintf(stderr, "%s: missing fmt or data chunk.\n", path.c_str());
+        return false;
+    }
+
+    void mapFile()
+    {
+#ifdef FILE_SOURCE_MMAP
+        int fd = fileno(fp);
+        struct stat sb{};
+        if (fstat(fd, &sb) != 0)
+        {
+            return;
+        }
+
+        //A truncated download can claim more data than the file holds.
+        uint64_t end = std::min<uint64_t>(dataOffset + dataBytes, static_cast<uint64_t>(sb.st_size));
+        if (end <= static_cast<uint64_t>(dataOffset))
+        {
+            return;
+        }
+
+        void *p = mmap(nullptr, end, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            return;
+        }
+
+        madvise(p, end, MADV_SEQUENTIAL); //aggressive readahead, early reclaim behind us.
+#ifdef MADV_HUGEPAGE
+        madvise(p, end, MADV_HUGEPAGE); //only honoured where file THP is enabled.
+#endif
+        map = static_cast<const unsigned char *>(p);
+        mapBytes = end;
+        dataBytes = end - dataOffset;
+#endif
+    }
+
+    // Paced: sleep until the blocks-th block would have been fully captured. Unpaced: wait for a free slot.
+    void waitTurn(uint64_t blocks)
+    {
+        broadcastRing &rb = reblock.rb;
+        if (paced)
+        {
+            std::this_thread::sleep_until(t0 + std::chrono::duration<double>(blocks * rb.frames / fs));
+            return;
+        }
+
+        //Back-pressure instead of dropping.
+        while (rb.full() && running.load(std::memory_order_relaxed))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    void runMapped()
+    {
+        broadcastRing &rb = reblock.rb;
+        const size_t frames = rb.frames;
+        //WAV data starts word aligned, so the samples are int16 aligned.
+        const int16_t *pcm = reinterpret_cast<const int16_t *>(map + dataOffset);
+        const uint64_t total = dataBytes / sizeof(int16_t);
+        uint64_t blocks = 0;
+
+        for (uint64_t pos = 0; pos < total && running.load(std::memory_order_relaxed); pos += frames)
+        {
+            waitTurn(++blocks);
+
+            size_t n = static_cast<size_t>(std::min<uint64_t>(frames, total - pos));
+            Block *slot = rb.claim(); //if full, increment dropped counter internally
+            if (slot == nullptr)
+            {
+                reblock.framesDropped.fetch_add(n, std::memory_order_relaxed);
+                continue;
+            }
+
+            if (n == frames)
+            {
+                //Zero copy: the consumer reads the mapping through a const Block.
+                slot->samples = const_cast<int16_t *>(pcm + pos);
+            }
+            else
+            {
+                int16_t *lane = slot->lane<int16_t>(0);
+                std::memcpy(lane, pcm + pos, n * sizeof(int16_t));
+                std::fill(lane + n, lane + frames, 0);
+            }
+
+            slot->adcTime = pos / fs;
+            reblock.onFull(slot);
+            rb.commit();
+        }
+
+        finished.store(true, std::memory_order_release);
+        rb.wakeReaders();
+    }
+
+    void run()
+    {
+        broadcastRing &rb = reblock.rb;
+        const size_t frames = rb.frames;
+        uint64_t left = dataBytes / (sizeof(int16_t) * channels);
+        uint64_t blocks = 0;
+        uint64_t pos = 0;
+
+        while (running.load(std::memory_order_relaxed) && left > 0)
+        {
+            size_t want = static_cast<size_t>(std::min<uint64_t>(frames, left));
+            size_t got = std::fread(chunk.data(), sizeof(int16_t) * channels, want, fp);
+            if (got == 0)
+            {
+                break;
+            }
+            left -= got;
+
+            //Pad the final partial block with silence.
+            std::fill(chunk.begin() + got * channels, chunk.end(), 0);
+
+            waitTurn(++blocks);
+            reblock.write(chunk.data(), frames, pos / fs);
+            pos += frames;
+        }
+
+        finished.store(true, std::memory_order_release);
+        rb.wakeReaders();
+    }
+};
@@ -0,0 +1,696 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "spscRing.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LEVEL_METER_X86 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define LEVEL_METER_NEON 1
+#endif
+
+// Exact integer level statistics for one block. int16 lanes are measured at
+// 16 bits; int32 and float lanes are measured at 24 bits, which keeps the
+// sums exact in 64 bits for any block size.
+struct levelStats
+{
+    uint64_t sumSq = 0; //sum of s*s.
+    int64_t sum = 0; //sum of s, for DC offset.
+    uint32_t peak = 0; //max |s|, fullScale for full-scale negative.
+    size_t n = 0;
+    double fullScale = 32768.0;
+
+    double rms() const
+    {
+        return n == 0 ? 0.0 : std::sqrt(static_cast<double>(sumSq) / n) / fullScale;
+    }
+
+    double dc() const
+    {
+        return n == 0 ? 0.0 : static_cast<double>(sum) / n / fullScale;
+    }
+
+    double peakLevel() const
+    {
+        return peak / fullScale;
+    }
+};
+
+// One pass over a lane: fills stats and writes the samples scaled to [-1, 1)
+// into dst. This is the pipeline's single conversion point to float.
+using levelMeterFn = void (*)(const void *in, float *dst, size_t n, levelStats &st);
+
+namespace levelMeter
+{
+    constexpr float FSCALE = 1.0f/32768.0f;
+
+    inline void tail(const int16_t *src, float *dst, size_t i, size_t n, levelStats &st)
+    {
+        for (; i < n; i++)
+        {
+            int32_t s = src[i];
+            st.sumSq += static_cast<uint64_t>(s * s);
+            st.sum += s;
+            st.peak = std::max(st.peak, static_cast<uint32_t>(std::abs(s)));
+            dst[i] = static_cast<float>(s) * FSCALE;
+        }
+    }
+
+    struct scalar
+    {
+        template <size_t N>
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            const int16_t *src = static_cast<const int16_t *>(in);
+            st = levelStats{};
+            st.n = n;
+            tail(src, dst, 0, n, st);
+        }
+    };
+
+#ifdef LEVEL_METER_X86
+    //pmaddwd of two -32768 squares is exactly 2^31, so lanes are widened as unsigned.
+    struct sse41
+    {
+        template <size_t N>
+        __attribute__((target("sse4.1")))
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            const int16_t *src = static_cast<const int16_t *>(in);
+            st = levelStats{};
+            st.n = n;
+
+            const __m128i ones = _mm_set1_epi16(1);
+            const __m128 scale = _mm_set1_ps(FSCALE);
+            __m128i sq = _mm_setzero_si128();
+            __m128i sm = _mm_setzero_si128();
+            __m128i pk = _mm_setzero_si128();
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+
+                __m128i p = _mm_madd_epi16(v, v);
+                sq = _mm_add_epi64(sq, _mm_cvtepu32_epi64(p));
+                sq = _mm_add_epi64(sq, _mm_cvtepu32_epi64(_mm_srli_si128(p, 8)));
+
+                __m128i s = _mm_madd_epi16(v, ones);
+                sm = _mm_add_epi64(sm, _mm_cvtepi32_epi64(s));
+                sm = _mm_add_epi64(sm, _mm_cvtepi32_epi64(_mm_srli_si128(s, 8)));
+
+                pk = _mm_max_epu16(pk, _mm_abs_epi16(v));
+
+                __m128i lo = _mm_cvtepi16_epi32(v);
+                __m128i hi = _mm_cvtepi16_epi32(_mm_srli_si128(v, 8));
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+                _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+            }
+
+            alignas(16) uint64_t q[2];
+            alignas(16) int64_t s[2];
+            alignas(16) uint16_t m[8];
+            _mm_store_si128(reinterpret_cast<__m128i *>(q), sq);
+            _mm_store_si128(reinterpret_cast<__m128i *>(s), sm);
+            _mm_store_si128(reinterpret_cast<__m128i *>(m), pk);
+            st.sumSq = q[0] + q[1];
+            st.sum = s[0] + s[1];
+            st.peak = *std::max_element(m, m + 8);
+
+            tail(src, dst, i, n, st);
+        }
+    };
+
+    struct avx2
+    {
+        template <size_t N>
+        __attribute__((target("avx2")))
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            const int16_t *src = static_cast<const int16_t *>(in);
+            st = levelStats{};
+            st.n = n;
+
+            const __m256i ones = _mm256_set1_epi16(1);
+            const __m256 scale = _mm256_set1_ps(FSCALE);
+            __m256i sq = _mm256_setzero_si256();
+            __m256i sm = _mm256_setzero_si256();
+            __m256i pk = _mm256_setzero_si256();
+
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+
+                __m256i p = _mm256_madd_epi16(v, v);
+                sq = _mm256_add_epi64(sq, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(p)));
+                sq = _mm256_add_epi64(sq, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(p, 1)));
+
+                __m256i s = _mm256_madd_epi16(v, ones);
+                sm = _mm256_add_epi64(sm, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(s)));
+                sm = _mm256_add_epi64(sm, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(s, 1)));
+
+                pk = _mm256_max_epu16(pk, _mm256_abs_epi16(v));
+
+                __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v));
+                __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1));
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+                _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+            }
+
+            alignas(32) uint64_t q[4];
+            alignas(32) int64_t s[4];
+            alignas(32) uint16_t m[16];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(q), sq);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(s), sm);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(m), pk);
+            st.sumSq = q[0] + q[1] + q[2] + q[3];
+            st.sum = s[0] + s[1] + s[2] + s[3];
+            st.peak = *std::max_element(m, m + 16);
+
+            tail(src, dst, i, n, st);
+        }
+    };
+
+    struct avx512
+    {
+        template <size_t N>
+        __attribute__((target("avx512f,avx512bw")))
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            const int16_t *src = static_cast<const int16_t *>(in);
+            st = levelStats{};
+            st.n = n;
+
+            const __m512i ones = _mm512_set1_epi16(1);
+            const __m512 scale = _mm512_set1_ps(FSCALE);
+            __m512i sq = _mm512_setzero_si512();
+            __m512i sm = _mm512_setzero_si512();
+            __m512i pk = _mm512_setzero_si512();
+
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32)
+            {
+                __m512i v = _mm512_loadu_si512(src + i);
+
+                __m512i p = _mm512_madd_epi16(v, v);
+                sq = _mm512_add_epi64(sq, _mm512_cvtepu32_epi64(_mm512_castsi512_si256(p)));
+                sq = _mm512_add_epi64(sq, _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(p, 1)));
+
+                __m512i s = _mm512_madd_epi16(v, ones);
+                sm = _mm512_add_epi64(sm, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(s)));
+                sm = _mm512_add_epi64(sm, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(s, 1)));
+
+                pk = _mm512_max_epu16(pk, _mm512_abs_epi16(v));
+
+                __m512i lo = _mm512_cvtepi16_epi32(_mm512_castsi512_si256(v));
+                __m512i hi = _mm512_cvtepi16_epi32(_mm512_extracti64x4_epi64(v, 1));
+                _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_cvtepi32_ps(lo), scale));
+                _mm512_storeu_ps(dst + i + 16, _mm512_mul_ps(_mm512_cvtepi32_ps(hi), scale));
+            }
+
+            alignas(64) uint16_t m[32];
+            _mm512_store_si512(m, pk);
+            st.sumSq = static_cast<uint64_t>(_mm512_reduce_add_epi64(sq));
+            st.sum = _mm512_reduce_add_epi64(sm);
+            st.peak = *std::max_element(m, m + 32);
+
+            tail(src, dst, i, n, st);
+        }
+    };
+#endif
+
+#ifdef LEVEL_METER_NEON
+    struct neon
+    {
+        template <size_t N>
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            const int16_t *src = static_cast<const int16_t *>(in);
+            st = levelStats{};
+            st.n = n;
+
+            uint64x2_t sq = vdupq_n_u64(0);
+            int64x2_t sm = vdupq_n_s64(0);
+            uint16x8_t pk = vdupq_n_u16(0);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                int16x8_t v = vld1q_s16(src + i);
+                int16x4_t vl = vget_low_s16(v);
+                int16x4_t vh = vget_high_s16(v);
+
+                //Single squares fit in 2^30, so the int32 products are exact.
+                sq = vpadalq_u32(sq, vreinterpretq_u32_s32(vmull_s16(vl, vl)));
+                sq = vpadalq_u32(sq, vreinterpretq_u32_s32(vmull_s16(vh, vh)));
+                sm = vpadalq_s32(sm, vpaddlq_s16(v));
+                pk = vmaxq_u16(pk, vreinterpretq_u16_s16(vabsq_s16(v)));
+
+                vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vl)), FSCALE));
+                vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vh)), FSCALE));
+            }
+
+            st.sumSq = vgetq_lane_u64(sq, 0) + vgetq_lane_u64(sq, 1);
+            st.sum = vgetq_lane_s64(sm, 0) + vgetq_lane_s64(sm, 1);
+            st.peak = vmaxvq_u16(pk);
+
+            tail(src, dst, i, n, st);
+        }
+    };
+#endif
+
+    // 32-bit lanes are measured at 24 bits: s = v >> 8 for int32, v * 2^23 for float.
+    constexpr float WIDE_SCALE = 8388608.0f;
+    constexpr float I32_FSCALE = 1.0f/2147483648.0f;
+
+    inline void tail24(int32_t s, levelStats &st)
+    {
+        st.sumSq += static_cast<uint64_t>(static_cast<int64_t>(s) * s);
+        st.sum += s;
+        st.peak = std::max(st.peak, static_cast<uint32_t>(s < 0 ? -static_cast<int64_t>(s) : s));
+    }
+
+    inline int32_t floatTo24(float x)
+    {
+        x = std::min(1.0f, std::max(-1.0f, x));
+        return static_cast<int32_t>(std::lrint(x * WIDE_SCALE));
+    }
+
+    inline void wideInit(levelStats &st, size_t n)
+    {
+        st = levelStats{};
+        st.n = n;
+        st.fullScale = WIDE_SCALE;
+    }
+
+    // The 32-bit SIMD kernels below run these only for run<0>: every forSize()
+    // block size is a multiple of their vector width.
+    inline void tailI32(const int32_t *src, float *dst, size_t i, size_t n, levelStats &st)
+    {
+        for (; i < n; i++)
+        {
+            tail24(src[i] >> 8, st);
+            dst[i] = static_cast<float>(src[i]) * I32_FSCALE;
+        }
+    }
+
+    inline void tailF32(const float *src, float *dst, size_t i, size_t n, levelStats &st)
+    {
+        for (; i < n; i++)
+        {
+            tail24(floatTo24(src[i]), st);
+            dst[i] = src[i];
+        }
+    }
+
+    struct i32Scalar
+    {
+        template <size_t N>
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            wideInit(st, n);
+            tailI32(static_cast<const int32_t *>(in), dst, 0, n, st);
+        }
+    };
+
+    struct f32Scalar
+    {
+        template <size_t N>
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            wideInit(st, n);
+            tailF32(static_cast<const float *>(in), dst, 0, n, st);
+        }
+    };
+
+#ifdef LEVEL_METER_X86
+    // Stats for 4 lanes of 24-bit values held in int32.
+    __attribute__((target("sse4.1")))
+    inline void add24(__m128i s, __m128i &sq, __m128i &sm, __m128i &pk)
+    {
+        sq = _mm_add_epi64(sq, _mm_mul_epi32(s, s));
+        __m128i odd = _mm_srli_epi64(s, 32);
+        sq = _mm_add_epi64(sq, _mm_mul_epi32(odd, odd));
+        sm = _mm_add_epi64(sm, _mm_cvtepi32_epi64(s));
+        sm = _mm_add_epi64(sm, _mm_cvtepi32_epi64(_mm_srli_si128(s, 8)));
+        pk = _mm_max_epu32(pk, _mm_abs_epi32(s));
+    }
+
+    __attribute__((target("sse4.1")))
+    inline void finish24(__m128i sq, __m128i sm, __m128i pk, levelStats &st)
+    {
+        alignas(16) uint64_t q[2];
+        alignas(16) int64_t m[2];
+        alignas(16) uint32_t p[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(q), sq);
+        _mm_store_si128(reinterpret_cast<__m128i *>(m), sm);
+        _mm_store_si128(reinterpret_cast<__m128i *>(p), pk);
+        st.sumSq += q[0] + q[1];
+        st.sum += m[0] + m[1];
+        st.peak = std::max(st.peak, *std::max_element(p, p + 4));
+    }
+
+    // Stats for 8 lanes of 24-bit values held in int32.
+    __attribute__((target("avx2")))
+    inline void add24(__m256i s, __m256i &sq, __m256i &sm, __m256i &pk)
+    {
+        //mul_epi32 squares the even lanes into 64 bits; shift the odd lanes down for the rest.
+        sq = _mm256_add_epi64(sq, _mm256_mul_epi32(s, s));
+        __m256i odd = _mm256_srli_epi64(s, 32);
+        sq = _mm256_add_epi64(sq, _mm256_mul_epi32(odd, odd));
+        sm = _mm256_add_epi64(sm, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(s)));
+        sm = _mm256_add_epi64(sm, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(s, 1)));
+        pk = _mm256_max_epu32(pk, _mm256_abs_epi32(s));
+    }
+
+    __attribute__((target("avx2")))
+    inline void finish24(__m256i sq, __m256i sm, __m256i pk, levelStats &st)
+    {
+        alignas(32) uint64_t q[4];
+        alignas(32) int64_t m[4];
+        alignas(32) uint32_t p[8];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(q), sq);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(m), sm);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(p), pk);
+        st.sumSq += q[0] + q[1] + q[2] + q[3];
+        st.sum += m[0] + m[1] + m[2] + m[3];
+        st.peak = std::max(st.peak, *std::max_element(p, p + 8));
+    }
+
+    struct i32Sse41
+    {
+        template <size_t N>
+        __attribute__((target("sse4.1")))
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            const int32_t *src = static_cast<const int32_t *>(in);
+            wideInit(st, n);
+            const __m128 scale = _mm_set1_ps(I32_FSCALE);
+            __m128i sq = _mm_setzero_si128();
+            __m128i sm = _mm_setzero_si128();
+            __m128i pk = _mm_setzero_si128();
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                add24(_mm_srai_epi32(v, 8), sq, sm, pk);
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+            }
+            finish24(sq, sm, pk, st);
+            if (N == 0)
+            {
+                tailI32(src, dst, i, n, st);
+            }
+        }
+    };
+
+    struct f32Sse41
+    {
+        template <size_t N>
+        __attribute__((target("sse4.1")))
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            const float *src = static_cast<const float *>(in);
+            wideInit(st, n);
+            const __m128 lo = _mm_set1_ps(-1.0f);
+            const __m128 hi = _mm_set1_ps(1.0f);
+            const __m128 scale = _mm_set1_ps(WIDE_SCALE);
+            __m128i sq = _mm_setzero_si128();
+            __m128i sm = _mm_setzero_si128();
+            __m128i pk = _mm_setzero_si128();
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128 v = _mm_loadu_ps(src + i);
+                __m128 x = _mm_min_ps(hi, _mm_max_ps(lo, v));
+                add24(_mm_cvtps_epi32(_mm_mul_ps(x, scale)), sq, sm, pk);
+                _mm_storeu_ps(dst + i, v);
+            }
+            finish24(sq, sm, pk, st);
+            if (N == 0)
+            {
+                tailF32(src, dst, i, n, st);
+            }
+        }
+    };
+
+    struct i32Avx2
+    {
+        template <size_t N>
+        __attribute__((target("avx2")))
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            const int32_t *src = static_cast<const int32_t *>(in);
+            wideInit(st, n);
+            const __m256 scale = _mm256_set1_ps(I32_FSCALE);
+            __m256i sq = _mm256_setzero_si256();
+            __m256i sm = _mm256_setzero_si256();
+            __m256i pk = _mm256_setzero_si256();
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+                add24(_mm256_srai_epi32(v, 8), sq, sm, pk);
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+            }
+            finish24(sq, sm, pk, st);
+            if (N == 0)
+            {
+                tailI32(src, dst, i, n, st);
+            }
+        }
+    };
+
+    struct f32Avx2
+    {
+        template <size_t N>
+        __attribute__((target("avx2")))
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            const float *src = static_cast<const float *>(in);
+            wideInit(st, n);
+            const __m256 lo = _mm256_set1_ps(-1.0f);
+            const __m256 hi = _mm256_set1_ps(1.0f);
+            const __m256 scale = _mm256_set1_ps(WIDE_SCALE);
+            __m256i sq = _mm256_setzero_si256();
+            __m256i sm = _mm256_setzero_si256();
+            __m256i pk = _mm256_setzero_si256();
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 v = _mm256_loadu_ps(src + i);
+                __m256 x = _mm256_min_ps(hi, _mm256_max_ps(lo, v));
+                add24(_mm256_cvtps_epi32(_mm256_mul_ps(x, scale)), sq, sm, pk);
+                _mm256_storeu_ps(dst + i, v);
+            }
+            finish24(sq, sm, pk, st);
+            if (N == 0)
+            {
+                tailF32(src, dst, i, n, st);
+            }
+        }
+    };
+#endif
+
+#ifdef LEVEL_METER_NEON
+    // Stats for 4 lanes of 24-bit values held in int32; squares fit in 2^46.
+    inline void add24(int32x4_t s, int64x2_t &sq, int64x2_t &sm, uint32x4_t &pk)
+    {
+        sq = vmlal_s32(sq, vget_low_s32(s), vget_low_s32(s));
+        sq = vmlal_s32(sq, vget_high_s32(s), vget_high_s32(s));
+        sm = vpadalq_s32(sm, s);
+        pk = vmaxq_u32(pk, vreinterpretq_u32_s32(vabsq_s32(s)));
+    }
+
+    inline void finish24(int64x2_t sq, int64x2_t sm, uint32x4_t pk, levelStats &st)
+    {
+        st.sumSq += static_cast<uint64_t>(vgetq_lane_s64(sq, 0) + vgetq_lane_s64(sq, 1));
+        st.sum += vgetq_lane_s64(sm, 0) + vgetq_lane_s64(sm, 1);
+        st.peak = std::max(st.peak, vmaxvq_u32(pk));
+    }
+
+    struct i32Neon
+    {
+        template <size_t N>
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            const int32_t *src = static_cast<const int32_t *>(in);
+            wideInit(st, n);
+            int64x2_t sq = vdupq_n_s64(0);
+            int64x2_t sm = vdupq_n_s64(0);
+            uint32x4_t pk = vdupq_n_u32(0);
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                int32x4_t v = vld1q_s32(src + i);
+                add24(vshrq_n_s32(v, 8), sq, sm, pk);
+                vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(v), I32_FSCALE));
+            }
+            finish24(sq, sm, pk, st);
+            if (N == 0)
+            {
+                tailI32(src, dst, i, n, st);
+            }
+        }
+    };
+
+    struct f32Neon
+    {
+        template <size_t N>
+        static void run(const void *in, float *dst, size_t count, levelStats &st)
+        {
+            const size_t n = N != 0 ? N : count;
+            const float *src = static_cast<const float *>(in);
+            wideInit(st, n);
+            const float32x4_t lo = vdupq_n_f32(-1.0f);
+            const float32x4_t hi = vdupq_n_f32(1.0f);
+            int64x2_t sq = vdupq_n_s64(0);
+            int64x2_t sm = vdupq_n_s64(0);
+            uint32x4_t pk = vdupq_n_u32(0);
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                float32x4_t v = vld1q_f32(src + i);
+                float32x4_t x = vminq_f32(hi, vmaxq_f32(lo, v));
+                //Round to nearest even, as lrint() does in floatTo24().
+                add24(vcvtnq_s32_f32(vmulq_n_f32(x, WIDE_SCALE)), sq, sm, pk);
+                vst1q_f32(dst + i, v);
+            }
+            finish24(sq, sm, pk, st);
+            if (N == 0)
+            {
+                tailF32(src, dst, i, n, st);
+            }
+        }
+    };
+#endif
+
+    // K::run<N> with the block size fixed at compile time for the common
+    // power-of-two sizes, so loops have constant trip counts and no tail;
+    // anything else gets the generic run<0>.
+    template <class K>
+    levelMeterFn forSize(size_t frames)
+    {
+        switch (frames)
+        {
+        case 64: return K::template run<64>;
+        case 128: return K::template run<128>;
+        case 256: return K::template run<256>;
+        case 512: return K::template run<512>;
+        case 1024: return K::template run<1024>;
+        case 2048: return K::template run<2048>;
+        case 4096: return K::template run<4096>;
+        default: return K::template run<0>;
+        }
+    }
+
+    struct kernel
+    {
+        const char *name;
+        levelMeterFn fn;
+    };
+
+    // Every kernel this CPU can run for this block size, slowest first.
+    inline size_t available(kernel *out, size_t frames)
+    {
+        size_t k = 0;
+        out[k++] = {"scalar", forSize<scalar>(frames)};
+#ifdef LEVEL_METER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            out[k++] = {"sse4.1", forSize<sse41>(frames)};
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            out[k++] = {"avx2", forSize<avx2>(frames)};
+        }
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        {
+            out[k++] = {"avx512", forSize<avx512>(frames)};
+        }
+#endif
+#ifdef LEVEL_METER_NEON
+        out[k++] = {"neon", forSize<neon>(frames)};
+#endif
+        return k;
+    }
+
+    // Best kernel for this CPU and block size.
+    inline kernel best(size_t frames)
+    {
+        kernel all[5];
+        size_t k = available(all, frames);
+        return all[k - 1];
+    }
+
+    // The int32 or float form of a 32-bit kernel pair, sized by forSize().
+    template <class KI, class KF>
+    kernel wide(bool isFloat, const char *iName, const char *fName, size_t frames)
+    {
+        return isFloat ? kernel{fName, forSize<KF>(frames)} : kernel{iName, forSize<KI>(frames)};
+    }
+
+    // Every kernel this CPU can run for lanes of type t, slowest first.
+    inline size_t available(sampleType t, kernel *out, size_t frames)
+    {
+        if (t == sampleType::i16)
+        {
+            return available(out, frames);
+        }
+        const bool f = t == sampleType::f32;
+        size_t k = 0;
+        out[k++] = wide<i32Scalar, f32Scalar>(f, "scalar-i32", "scalar-f32", frames);
+#ifdef LEVEL_METER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            out[k++] = wide<i32Sse41, f32Sse41>(f, "sse4.1-i32", "sse4.1-f32", frames);
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            out[k++] = wide<i32Avx2, f32Avx2>(f, "avx2-i32", "avx2-f32", frames);
+        }
+#endif
+#ifdef LEVEL_METER_NEON
+        out[k++] = wide<i32Neon, f32Neon>(f, "neon-i32", "neon-f32", frames);
+#endif
+        return k;
+    }
+
+    // Best kernel for lanes of type t.
+    inline kernel best(sampleType t, size_t frames)
+    {
+        kernel all[5];
+        size_t k = available(t, all, frames);
+        return all[k - 1];
+    }
+}
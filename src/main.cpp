@@ -1,5 +1,4 @@
 #include <iostream>
-#include <portaudio.h>
 #include <cstdio>
 #include <cstdlib>
 #include <array>
@@ -9,199 +8,1259 @@
 #include <vector>
 #include <chrono>
 #include <cmath>
-#include <deque>
+#include <algorithm>
+#include <numeric>
+#include <memory>
 
-constexpr unsigned long FRAMES_PER_BLOCK = 512; //Previously opened.
-using Block = std::array<int16_t, FRAMES_PER_BLOCK>; // Defining one audio block.
+#include "allocGuard.hpp"
+#include "asyncLog.hpp"
+#include "broadcastRing.hpp"
+#include "spscRing.hpp"
+#include "sampleHistory.hpp"
+#include "stft.hpp"
+#include "melFilterbank.hpp"
+#include "mfcc.hpp"
+#include "resampler.hpp"
+#include "levelMeter.hpp"
+#include "paSource.hpp"
+#include "fft.hpp"
+#include "fileSource.hpp"
+#include "rtThread.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <sys/wait.h>
+#endif
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
 
 //Global FIFO
-static std::deque<float> g_fifo;
-static constexpr size_t FIFO_MAX = 44100 * 3; //capped at 3 seconds of audio.
+static sampleHistory g_fifo;
+static constexpr double HISTORY_SECONDS = 3.0; //at least 3 seconds of audio, sized at stream open.
+static sampleHistory g_model; //channel 0 resampled to the model rate; what the feature stages read.
+
+static broadcastRing g_rb; //making the ring buffer instance global 
+
+//Status output from the processing loop goes through here, never straight to stdout.
+static asyncLog g_log;
+
+//Per-channel RMS goes out in records of up to 7 values, led by the first channel's index.
+static const char *const CHANNEL_RMS_FMT[] = {
+    "",
+    "  ch%zu+ RMS: %.4f\n",
+    "  ch%zu+ RMS: %.4f %.4f\n",
+    "  ch%zu+ RMS: %.4f %.4f %.4f\n",
+    "  ch%zu+ RMS: %.4f %.4f %.4f %.4f\n",
+    "  ch%zu+ RMS: %.4f %.4f %.4f %.4f %.4f\n",
+    "  ch%zu+ RMS: %.4f %.4f %.4f %.4f %.4f %.4f\n",
+    "  ch%zu+ RMS: %.4f %.4f %.4f %.4f %.4f %.4f %.4f\n",
+};
+
+//Commit time of each ring slot, for callback-to-pop latency.
+static std::vector<int64_t> g_commitNs;
+
+static int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The heap block behind v, for rtThread::lockMemory().
+template <class T>
+static rtThread::region regionOf(std::vector<T> &v)
+{
+    return {v.data(), v.size() * sizeof(T)};
+}
+
+// What recordBlocks() wrote: frames in the file, blocks of silence standing in
+// for ones never recorded, and torn blocks left out (they become gaps too).
+struct recordCounts
+{
+    size_t frames = 0;
+    size_t gapBlocks = 0;
+    size_t torn = 0;
+};
 
-// Minimal SPSC ring buffer.
-struct spscRing
+// Second ring reader: writes every block it gets as interleaved raw PCM in the
+// ring's lane type, at its own pace, until the source is done or stop is set.
+// Blocks it never gets (dropped, lapped or torn) are written as silence, so
+// the file keeps the capture's length.
+static void recordBlocks(ringReader &rd, std::FILE *out, const audioSource &src, const std::atomic<bool> &stop,
+                         recordCounts &counts)
 {
-    static constexpr size_t CAP = 64; // 2 sercond safety at 24 kHz with 512f.
-    std::array<Block, CAP> buf{};
-    std::atomic<size_t> w{0}; //ever-increasing.
-    std::atomic<size_t> r{0}; //ever-increasing.
-    std::atomic<size_t> dropped{0};
+    const size_t nch = g_rb.channels;
+    const size_t sb = sampleBytes(g_rb.type);
+    std::vector<unsigned char> frame(g_rb.slotBytes());
+    const std::vector<unsigned char> silence(g_rb.slotBytes(), 0); //zero bits are silence in every lane type.
+    uint64_t nextSeq = 0;
 
-    bool push(const Block &b)
+    for (;;)
     {
-        size_t wi = w.load(std::memory_order_relaxed);
-        size_t ri = r.load(std::memory_order_acquire);
+        //Read before peeking: an empty peek after done() means every last block was seen.
+        bool drained = src.done() || stop.load(std::memory_order_relaxed);
+        blockSpan batch = rd.peekBatch(16);
+        if (batch.size() == 0)
+        {
+            if (drained)
+            {
+                break;
+            }
+            rd.waitFor(std::chrono::milliseconds(100));
+            continue;
+        }
 
-        if (wi - ri >= CAP)
+        for (size_t b = 0; b < batch.size(); b++)
         {
-            dropped.fetch_add(1, std::memory_order_relaxed);
-            return false;
+            const Block &blk = batch[b];
+
+            //Same stamp checks as the meter loop: before trusting seq and after the copy.
+            uint64_t seq = blk.seq;
+            if (!rd.intact(b) || seq < nextSeq)
+            {
+                ++counts.torn;
+                continue;
+            }
+            for (size_t c = 0; c < nch; c++)
+            {
+                const unsigned char *lane = static_cast<const unsigned char *>(blk.rawLane(c));
+                for (size_t i = 0; i < g_rb.frames; i++)
+                {
+                    std::memcpy(&frame[(i * nch + c) * sb], lane + i * sb, sb);
+                }
+            }
+            if (!rd.intact(b))
+            {
+                ++counts.torn;
+                continue;
+            }
+
+            for (; nextSeq < seq; nextSeq++)
+            {
+                std::fwrite(silence.data(), 1, silence.size(), out);
+                counts.frames += g_rb.frames;
+                ++counts.gapBlocks;
+            }
+            std::fwrite(frame.data(), 1, frame.size(), out);
+            counts.frames += g_rb.frames;
+            nextSeq = seq + 1;
         }
+        rd.releaseBatch(batch.size()); //torn blocks were already left out above.
+    }
+}
 
-        buf[wi % CAP] = b;
-        w.store(wi + 1, std::memory_order_release);
-        return true;
+// --stress: n processes that each stream through 16 MiB forever, competing
+// with the capture path for cores, caches and memory bandwidth. Separate
+// processes so they stay outside this one's memory lock and scheduling. Each
+// one dies with this process, even on an early exit that skips stopStress().
+static std::vector<int> startStress(int n)
+{
+    std::vector<int> pids;
+#if defined(__unix__) || defined(__APPLE__)
+    const pid_t parent = getpid();
+    for (int i = 0; i < n; i++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+#ifdef __linux__
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+            //Also covers a parent that died before prctl(), and hosts without it.
+            std::vector<unsigned char> mem(16 << 20);
+            for (unsigned char v = 0; getppid() == parent; v++)
+            {
+                for (size_t j = 0; j < mem.size(); j += 64)
+                {
+                    mem[j] += v;
+                }
+            }
+            _exit(0);
+        }
+        if (pid > 0)
+        {
+            pids.push_back(pid);
+        }
     }
+#else
+    (void)n;
+    std::fprintf(stderr, "--stress needs fork(); running without load.\n");
+#endif
+    return pids;
+}
 
-    bool pop(Block &out)
+static void stopStress(const std::vector<int> &pids)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    for (int pid : pids)
     {
-        size_t ri = r.load(std::memory_order_relaxed);
-        size_t wi = w.load(std::memory_order_acquire);
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+#else
+    (void)pids;
+#endif
+}
 
-        if (wi == ri)
+// Per-block cost of every level meter kernel this CPU supports, both
+// specialised for the block size and generic.
+static void benchLevelMeter(size_t frames)
+{
+    std::vector<int16_t> blk(frames);
+    std::srand(1);
+    for (auto &s : blk)
+    {
+        s = static_cast<int16_t>(std::rand() - RAND_MAX / 2);
+    }
+    std::vector<float> out(blk.size());
+
+    levelMeter::kernel fixed[5];
+    levelMeter::kernel generic[5];
+    size_t k = levelMeter::available(fixed, frames);
+    levelMeter::available(generic, 0); //no size matches 0, so these are the run<0> forms.
+    constexpr int ITERS = 200000;
+
+    for (size_t i = 0; i < 2 * k; i++)
+    {
+        const levelMeter::kernel &kn = i < k ? fixed[i] : generic[i - k];
+        levelStats st;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int it = 0; it < ITERS; it++)
         {
-            return false;
+            kn.fn(blk.data(), out.data(), blk.size(), st);
+            asm volatile("" : : "r"(out.data()), "r"(&st) : "memory");
         }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        std::printf("%-8s %-7s %8.1f ns/block (%zu frames) | rms %.6f peak %u\n", kn.name, i < k ? "fixed" : "generic",
+                    ns / ITERS, frames, st.rms(), st.peak);
+    }
+}
 
-        out = buf[ri % CAP];
-        r.store(ri + 1, std::memory_order_release);
-        return true;
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+
+// Hardware cache-miss counter for this process (all threads), or -1 if perf is unavailable.
+static int openCacheMissCounter()
+{
+    perf_event_attr pe{};
+    pe.type = PERF_TYPE_HARDWARE;
+    pe.size = sizeof(pe);
+    pe.config = PERF_COUNT_HW_CACHE_MISSES;
+    pe.disabled = 1;
+    pe.inherit = 1;
+    pe.exclude_kernel = 1;
+    pe.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &pe, 0, -1, -1, 0));
+}
+#endif
+
+// Two threads streaming small blocks through the ring as fast as they can.
+static void benchRing()
+{
+    constexpr size_t OPS = 5000000;
+    spscRing rb;
+    rb.init(MIN_FRAMES_PER_BLOCK);
+
+#if defined(__linux__)
+    int fd = openCacheMissCounter();
+    if (fd >= 0)
+    {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
     }
-};
+#endif
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::thread producer([&rb]
+    {
+        for (size_t i = 0; i < OPS;)
+        {
+            Block *slot = rb.claim();
+            if (slot != nullptr)
+            {
+                slot->lane<int16_t>(0)[0] = static_cast<int16_t>(i);
+                rb.commit();
+                ++i;
+            }
+            else
+            {
+                std::this_thread::yield(); //keeps the bench usable on a single core.
+            }
+        }
+    });
 
-static spscRing g_rb; //making the ring buffer instance global 
+    uint64_t check = 0;
+    for (size_t i = 0; i < OPS;)
+    {
+        const Block *slot = rb.peek();
+        if (slot != nullptr)
+        {
+            check += static_cast<uint16_t>(slot->lane<int16_t>(0)[0]);
+            rb.release();
+            ++i;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    long long misses = -1;
+#if defined(__linux__)
+    if (fd >= 0)
+    {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &misses, sizeof(misses)) != sizeof(misses))
+        {
+            misses = -1;
+        }
+        close(fd);
+    }
+#endif
 
+    std::printf("Ring: %.1f M ops/s (%zu ops, %.3f s, check %llu)", OPS / secs / 1e6, OPS, secs,
+                static_cast<unsigned long long>(check));
+    if (misses >= 0)
+    {
+        std::printf(" | cache misses: %lld (%.3f per op)\n", misses, static_cast<double>(misses) / OPS);
+    }
+    else
+    {
+        std::printf(" | cache misses: n/a (perf_event_open not permitted)\n");
+    }
+}
 
-static void checkPa(PaError e, const char *where)
+// Real FFT against a table-driven naive DFT over typical frame sizes, with the
+// worst bin error as a correctness check.
+static void benchFft()
 {
-    if (e != paNoError)
+    for (size_t n : {256, 400, 480, 512, 1000, 1024, 2048, 4096, 8192})
     {
-        std::fprintf(stderr, "PortAudio error at %s: %s\n", where, Pa_GetErrorText(e));
-        std::exit(1);
+        realFft *plan = fft::plan(n);
+        std::vector<float> x(n), re(n / 2 + 1), im(n / 2 + 1);
+        std::srand(static_cast<unsigned>(n));
+        for (auto &v : x)
+        {
+            v = static_cast<float>(std::rand()) / RAND_MAX - 0.5f;
+        }
+
+        const int iters = static_cast<int>(std::max<size_t>(20, 4000000 / n));
+        auto t0 = std::chrono::steady_clock::now();
+        for (int it = 0; it < iters; it++)
+        {
+            plan->forward(x.data(), re.data(), im.data());
+            asm volatile("" : : "r"(re.data()) : "memory");
+        }
+        double fftUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / iters;
+
+        std::vector<double> c(n), s(n);
+        for (size_t t = 0; t < n; t++)
+        {
+            c[t] = std::cos(-2.0 * fft::PI * t / n);
+            s[t] = std::sin(-2.0 * fft::PI * t / n);
+        }
+        std::vector<double> dr(n / 2 + 1), di(n / 2 + 1);
+        t0 = std::chrono::steady_clock::now();
+        for (size_t k = 0; k <= n / 2; k++)
+        {
+            double sr = 0.0, si = 0.0;
+            for (size_t t = 0, at = 0; t < n; t++, at = (at + k) % n)
+            {
+                sr += x[t] * c[at];
+                si += x[t] * s[at];
+            }
+            dr[k] = sr;
+            di[k] = si;
+        }
+        double dftUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+
+        double err = 0.0;
+        for (size_t k = 0; k <= n / 2; k++)
+        {
+            err = std::max(err, std::hypot(dr[k] - re[k], di[k] - im[k]));
+        }
+
+        std::printf("FFT %5zu (%zu stages): %8.2f us | naive DFT: %10.1f us (%6.0fx) | max bin error %.1e\n", n,
+                    plan->stages.size(), fftUs, dftUs, dftUs / fftUs, err);
     }
 }
 
-// PortAudio Callback
+// Sparse against dense filterbank application, and the vector log against std::log.
+static void benchMel()
+{
+    const double fs = 16000.0;
+    for (size_t nfft : {400, 512, 1024})
+    {
+        for (size_t mels : {40, 64, 128})
+        {
+            melFilterbank bank;
+            bank.init(mels, nfft, fs, 0.0, fs / 2.0, melScale::slaney);
+            size_t bins = bank.bins;
 
-static int paCallback(const void *input, void *, unsigned long frames,
-                      const PaStreamCallbackTimeInfo*, PaStreamCallbackFlags statusFlags,
-                      void *)
+            std::vector<float> dense(mels * bins, 0.0f);
+            for (size_t m = 0; m < mels; m++)
+            {
+                for (uint32_t i = bank.offset[m]; i < bank.offset[m + 1]; i++)
+                {
+                    dense[m * bins + bank.first[m] + i - bank.offset[m]] = bank.weights[i];
+                }
+            }
+            std::vector<float> power(bins), a(mels), b(mels);
+            std::srand(static_cast<unsigned>(nfft + mels));
+            for (auto &v : power)
+            {
+                v = static_cast<float>(std::rand()) / RAND_MAX;
+            }
+
+            const int iters = 20000;
+            auto t0 = std::chrono::steady_clock::now();
+            for (int it = 0; it < iters; it++)
+            {
+                bank.apply(power.data(), a.data());
+                asm volatile("" : : "r"(a.data()) : "memory");
+            }
+            double sparseUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / iters;
+
+            t0 = std::chrono::steady_clock::now();
+            for (int it = 0; it < iters; it++)
+            {
+                for (size_t m = 0; m < mels; m++)
+                {
+                    float acc = 0.0f;
+                    for (size_t k = 0; k < bins; k++)
+                    {
+                        acc += dense[m * bins + k] * power[k];
+                    }
+                    b[m] = acc;
+                }
+                asm volatile("" : : "r"(b.data()) : "memory");
+            }
+            double denseUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / iters;
+
+            float err = 0.0f;
+            for (size_t m = 0; m < mels; m++)
+            {
+                err = std::max(err, std::fabs(a[m] - b[m]));
+            }
+            std::printf("Mel %4zu bins -> %3zu bands: sparse %6.2f us (%5zu MACs) | dense %7.2f us (%6zu MACs) | %5.1fx | max diff %.1e\n",
+                        bins, mels, sparseUs, bank.nonzeros(), denseUs, mels * bins, denseUs / sparseUs, err);
+        }
+    }
+
+    std::vector<float> x(4096), y(x.size());
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        x[i] = std::exp(-30.0f + 40.0f * static_cast<float>(i) / x.size()); //e^-30 .. e^10
+    }
+    const int iters = 2000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int it = 0; it < iters; it++)
+    {
+        melLog::apply(x.data(), y.data(), x.size(), 1e-10f);
+        asm volatile("" : : "r"(y.data()) : "memory");
+    }
+    double fastNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / iters / x.size();
+    std::vector<float> z(x.size());
+    t0 = std::chrono::steady_clock::now();
+    for (int it = 0; it < iters; it++)
+    {
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            z[i] = std::log(std::max(x[i], 1e-10f));
+        }
+        asm volatile("" : : "r"(z.data()) : "memory");
+    }
+    double libNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / iters / x.size();
+    float err = 0.0f;
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        err = std::max(err, std::fabs(y[i] - z[i]));
+    }
+    std::printf("Log: vector %.2f ns/value | std::log %.2f ns/value | %.1fx | max abs error %.1e\n", fastNs, libNs,
+                libNs / fastNs, err);
+}
+
+// Brings g_model up to date with g_fifo, concealed samples included, so both
+// histories share one timeline at their own rates. fed is the g_fifo position
+// already passed to the resampler; chunk bounds the outputs written per call.
+static void feedModel(resampler &rs, size_t &fed, size_t chunk)
 {
-    if ((statusFlags & paInputOverflow) != 0)
+    //A gap longer than the history left nothing to filter; it is silence at either rate.
+    size_t oldest = g_fifo.written - g_fifo.size();
+    if (fed < oldest)
     {
+        g_model.fillGap(rs.skip(oldest - fed), concealMode::silence, 0);
+        fed = oldest;
+    }
 
+    while (fed < g_fifo.written)
+    {
+        size_t n = std::min(g_fifo.written - fed, chunk);
+        g_model.advance(rs.process(g_fifo.at(fed), n, g_model.writePtr()));
+        fed += n;
     }
-    if (frames != FRAMES_PER_BLOCK || input == nullptr)
+
+    //Marker gaps carry over to every output whose filter reaches into them.
+    if (g_fifo.cleanFrom > 0)
     {
-        return paContinue;
+        g_model.cleanFrom = std::max(g_model.cleanFrom, rs.firstOutputAfter(g_fifo.cleanFrom));
     }
+}
+
+// Throughput and accuracy of each preset on the common device-to-model conversions.
+static void benchResample()
+{
+    const uint32_t rates[][2] = {{48000, 16000}, {44100, 16000}, {32000, 16000}, {22050, 16000}, {16000, 48000}};
+    const resampleQuality presets[] = {resampleQuality::fast, resampleQuality::medium, resampleQuality::best};
+    const char *names[] = {"fast", "medium", "best"};
+    const size_t BLOCK = 512;
+
+    for (const auto &r : rates)
+    {
+        for (size_t q = 0; q < 3; q++)
+        {
+            resampler rs;
+            if (!rs.init(r[0], r[1], presets[q]))
+            {
+                continue;
+            }
+
+            //Ten seconds of a 1 kHz tone, in capture-sized blocks.
+            const double seconds = 10.0, tone = 1000.0;
+            std::vector<float> in(static_cast<size_t>(seconds * r[0]));
+            for (size_t i = 0; i < in.size(); i++)
+            {
+                in[i] = static_cast<float>(0.5 * std::sin(2.0 * fft::PI * tone * i / r[0]));
+            }
+            std::vector<float> out(rs.maxOutput(in.size()) + in.size() / BLOCK + 1);
+            size_t m = 0;
+            auto t0 = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < in.size(); i += BLOCK)
+            {
+                m += rs.process(in.data() + i, std::min(BLOCK, in.size() - i), out.data() + m);
+            }
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+            //Against the ideal tone at each output instant, past the start-up transient.
+            double errSq = 0.0, sigSq = 0.0;
+            for (size_t k = rs.taps * 2; k < m; k++)
+            {
+                double t = static_cast<double>(k) / r[1] - rs.delay() / r[0];
+                double ref = 0.5 * std::sin(2.0 * fft::PI * tone * t);
+                errSq += (out[k] - ref) * (out[k] - ref);
+                sigSq += ref * ref;
+            }
 
-    Block b;
-    std::memcpy(b.data(), input, FRAMES_PER_BLOCK * sizeof(int16_t));
-    g_rb.push(b); //if full, increment dropped counter internally
-    return paContinue;
+            //Decimating, a tone above the output Nyquist should not come through at all.
+            if (r[1] >= r[0])
+            {
+                std::printf("Resample %5u -> %5u %-6s (%3zu/%-3zu, %3zu taps): %7.0fx real time | 1 kHz SNR %5.1f dB\n",
+                            r[0], r[1], names[q], rs.up, rs.down, rs.taps, seconds / secs,
+                            10.0 * std::log10(sigSq / std::max(errSq, 1e-30)));
+                continue;
+            }
+            resampler alias;
+            alias.init(r[0], r[1], presets[q]);
+            double above = 0.52 * r[1];
+            for (size_t i = 0; i < in.size(); i++)
+            {
+                in[i] = static_cast<float>(0.5 * std::sin(2.0 * fft::PI * above * i / r[0]));
+            }
+            size_t ma = alias.process(in.data(), in.size(), out.data());
+            double aliasSq = 0.0;
+            for (size_t k = alias.taps * 2; k < ma; k++)
+            {
+                aliasSq += out[k] * out[k];
+            }
+            double aliasDb = 10.0 * std::log10(std::max(aliasSq / (ma - alias.taps * 2), 1e-30) / 0.125);
+
+            std::printf("Resample %5u -> %5u %-6s (%3zu/%-3zu, %3zu taps): %7.0fx real time | 1 kHz SNR %5.1f dB | "
+                        "%.0f Hz leak %6.1f dB\n",
+                        r[0], r[1], names[q], rs.up, rs.down, rs.taps, seconds / secs,
+                        10.0 * std::log10(sigSq / std::max(errSq, 1e-30)), above, aliasDb);
+        }
+    }
 }
 
-int main()
+int main(int argc, char **argv)
 {
-    checkPa(Pa_Initialize(), "Pa_Initialize");
+    //--poll restores the old 1 ms sleep loop, for latency comparison.
+    bool poll = false;
+    bool benchMeter = false;
+    bool benchRingOps = false;
+    bool benchFftSizes = false;
+    bool benchMelBank = false;
+    bool benchResampler = false;
+    size_t frames = DEFAULT_FRAMES_PER_BLOCK;
+    const char *file = nullptr; //--file: read a WAV (or --raw PCM at --rate) instead of the microphone.
+    bool raw = false;
+    bool paced = true; //--unpaced: run as fast as the consumer drains.
+    double rawRate = 0.0;
+    int channels = 1; //--channels: capture channels (raw files too; WAV files carry their own).
+    PaSampleFormat format = 0; //--format f32|i32|i24|i16; float32 (or the first fallback the host takes) by default.
+    overflowPolicy policy = overflowPolicy::dropNewest; //--policy drop|overwrite: what a full ring does with new audio.
+    const char *recordPath = nullptr; //--record: also write the stream as raw PCM from a second reader.
+    concealMode conceal = concealMode::silence; //--conceal silence|repeat|marker: what stands in for dropped blocks.
+    bool rt = false; //--rt: pin, raise and lock the processing thread (see rtThread.hpp).
+    int rtCpu = -1; //--rt-cpu N; default is the last CPU.
+    int rtPrio = 80; //--rt-prio N
+    bool rtRr = false; //--rt-rr: SCHED_RR instead of SCHED_FIFO.
+    int stress = 0; //--stress N: background load processes.
+    double modelRate = 16000.0; //--model-rate Hz: rate the feature stages run at; 0 keeps the device rate.
+    resampleQuality quality = resampleQuality::medium; //--resample fast|medium|best
+    double winMs = 25.0; //--win-ms: STFT window.
+    double hopMs = 10.0; //--hop-ms: STFT hop, independent of the block size.
+    windowType window = windowType::hann; //--window hann|hamming|bh
+    int mels = 64; //--mels N: log-mel bands.
+    double fmin = 0.0; //--fmin Hz
+    double fmax = 0.0; //--fmax Hz; 0 means Nyquist.
+    melScale scale = melScale::slaney; //--mel-scale htk|slaney
+    int ceps = 13; //--ceps N: cepstra per frame; vectors carry 3N values with the deltas.
+    int lifter = 22; //--lifter L; 0 disables it.
+    int deltaN = 2; //--delta-n N: delta regression half-width, frames.
+    bool allocCheck = false; //--alloc-check: fail the run if real-time threads touch the heap after warm-up.
+    bool allocAbort = false; //--alloc-abort: abort with a backtrace at the first such allocation.
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--poll") == 0)
+        {
+            poll = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-meter") == 0)
+        {
+            benchMeter = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-ring") == 0)
+        {
+            benchRingOps = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-fft") == 0)
+        {
+            benchFftSizes = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-mel") == 0)
+        {
+            benchMelBank = true;
+        }
+        else if (std::strcmp(argv[i], "--bench-resample") == 0)
+        {
+            benchResampler = true;
+        }
+        else if (std::strcmp(argv[i], "--block") == 0 && i + 1 < argc)
+        {
+            frames = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--file") == 0 && i + 1 < argc)
+        {
+            file = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--raw") == 0)
+        {
+            raw = true;
+        }
+        else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+        {
+            rawRate = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--unpaced") == 0)
+        {
+            paced = false;
+        }
+        else if (std::strcmp(argv[i], "--channels") == 0 && i + 1 < argc)
+        {
+            channels = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            const char *f = argv[++i];
+            format = std::strcmp(f, "f32") == 0 ? paFloat32 : std::strcmp(f, "i32") == 0 ? paInt32
+                   : std::strcmp(f, "i24") == 0 ? paInt24 : std::strcmp(f, "i16") == 0 ? paInt16 : 0;
+        }
+        else if (std::strcmp(argv[i], "--policy") == 0 && i + 1 < argc)
+        {
+            policy = std::strcmp(argv[++i], "overwrite") == 0 ? overflowPolicy::overwriteOldest
+                                                                 : overflowPolicy::dropNewest;
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            recordPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--conceal") == 0 && i + 1 < argc)
+        {
+            const char *m = argv[++i];
+            conceal = std::strcmp(m, "repeat") == 0 ? concealMode::repeatLast
+                    : std::strcmp(m, "marker") == 0 ? concealMode::marker : concealMode::silence;
+        }
+        else if (std::strcmp(argv[i], "--rt") == 0)
+        {
+            rt = true;
+        }
+        else if (std::strcmp(argv[i], "--rt-cpu") == 0 && i + 1 < argc)
+        {
+            rtCpu = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--rt-prio") == 0 && i + 1 < argc)
+        {
+            rtPrio = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--rt-rr") == 0)
+        {
+            rtRr = true;
+        }
+        else if (std::strcmp(argv[i], "--stress") == 0 && i + 1 < argc)
+        {
+            stress = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--model-rate") == 0 && i + 1 < argc)
+        {
+            modelRate = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--resample") == 0 && i + 1 < argc)
+        {
+            const char *q = argv[++i];
+            quality = std::strcmp(q, "fast") == 0 ? resampleQuality::fast
+                    : std::strcmp(q, "best") == 0 ? resampleQuality::best : resampleQuality::medium;
+        }
+        else if (std::strcmp(argv[i], "--win-ms") == 0 && i + 1 < argc)
+        {
+            winMs = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--hop-ms") == 0 && i + 1 < argc)
+        {
+            hopMs = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--window") == 0 && i + 1 < argc)
+        {
+            const char *w = argv[++i];
+            window = std::strcmp(w, "hamming") == 0 ? windowType::hamming
+                   : std::strcmp(w, "bh") == 0 ? windowType::blackmanHarris : windowType::hann;
+        }
+        else if (std::strcmp(argv[i], "--mels") == 0 && i + 1 < argc)
+        {
+            mels = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--fmin") == 0 && i + 1 < argc)
+        {
+            fmin = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--fmax") == 0 && i + 1 < argc)
+        {
+            fmax = std::strtod(argv[++i], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--mel-scale") == 0 && i + 1 < argc)
+        {
+            scale = std::strcmp(argv[++i], "htk") == 0 ? melScale::htk : melScale::slaney;
+        }
+        else if (std::strcmp(argv[i], "--ceps") == 0 && i + 1 < argc)
+        {
+            ceps = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--lifter") == 0 && i + 1 < argc)
+        {
+            lifter = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--delta-n") == 0 && i + 1 < argc)
+        {
+            deltaN = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--alloc-check") == 0)
+        {
+            allocCheck = true;
+        }
+        else if (std::strcmp(argv[i], "--alloc-abort") == 0)
+        {
+            allocCheck = true;
+            allocAbort = true;
+        }
+    }
 
-    int n = Pa_GetDeviceCount();
+    if (frames < MIN_FRAMES_PER_BLOCK || frames > MAX_FRAMES_PER_BLOCK)
+    {
+        std::fprintf(stderr, "Block size must be %lu to %lu frames.\n", MIN_FRAMES_PER_BLOCK, MAX_FRAMES_PER_BLOCK);
+        return 1;
+    }
 
-    if (n < 0)
+    if (channels < 1 || channels > 64)
     {
-        std::fprintf(stderr, "Pa_GetDeviceCount error: %s\n", Pa_GetErrorText(n));
+        std::fprintf(stderr, "Channel count must be 1 to 64.\n");
         return 1;
     }
 
-    std::printf("\nAudio devices: %d\n", n);
+    if (allocCheck && !allocGuard::enabled())
+    {
+        std::fprintf(stderr, "--alloc-check needs a build with -DALLOC_GUARD.\n");
+        return 1;
+    }
 
-    for (int i = 0; i < n; i++)
+    if (benchMeter)
     {
-        const PaDeviceInfo *di = Pa_GetDeviceInfo(i);
-        const PaHostApiInfo *hai = Pa_GetHostApiInfo(di->hostApi);
-        std::printf("[%2d] %-36s | Api: %-12s | in:%2d out:%2d | default SR: %.0f\n", i, di->name,
-                                                                                    hai->name, di->maxInputChannels,
-                                                                                    di->maxOutputChannels, di->defaultSampleRate);
+        benchLevelMeter(frames);
+        return 0;
     }
 
-    PaStreamParameters in{};
-    in.device = Pa_GetDefaultInputDevice();
+    if (benchRingOps)
+    {
+        benchRing();
+        return 0;
+    }
 
-    if (in.device == paNoDevice)
+    if (benchFftSizes)
     {
-        std::fprintf(stderr, "No default input device.\n");
+        benchFft();
+        return 0;
+    }
+
+    if (benchMelBank)
+    {
+        benchMel();
+        return 0;
+    }
+
+    if (benchResampler)
+    {
+        benchResample();
+        return 0;
+    }
+
+    std::unique_ptr<audioSource> src;
+    if (file != nullptr)
+    {
+        src = std::make_unique<fileSource>(g_rb, file, raw, rawRate, channels, paced);
+    }
+    else
+    {
+        src = std::make_unique<paSource>(g_rb, channels, format);
+    }
+
+    src->reblock.onFull = [](const Block *b) { g_commitNs[b - g_rb.buf.data()] = nowNs(); };
+
+    if (!src->open())
+    {
+        return 1;
+    }
+
+    //Ring slots and readers are set up once, before any producer can run.
+    size_t nch = src->channelCount();
+    g_rb.init(frames, nch, src->laneType(), policy);
+    g_commitNs.assign(g_rb.cap, 0);
+    ringReader &meterReader = g_rb.addReader();
+
+    std::FILE *recordFile = nullptr;
+    if (recordPath != nullptr)
+    {
+        recordFile = std::fopen(recordPath, "wb");
+        if (recordFile == nullptr)
+        {
+            std::fprintf(stderr, "Could not open %s for writing.\n", recordPath);
+            return 1;
+        }
+    }
+    ringReader *recordReader = recordFile ? &g_rb.addReader() : nullptr;
+
+    //Size the history from the rate the source actually runs at.
+    double fs = src->sampleRate();
+    if (!g_fifo.init(static_cast<size_t>(std::ceil(HISTORY_SECONDS * fs))))
+    {
+        std::fprintf(stderr, "Could not allocate sample history.\n");
+        return 1;
+    }
+
+    //The feature stages run at the model rate; resample channel 0 into its own history if the device differs.
+    double featFs = modelRate > 0.0 ? modelRate : fs;
+    bool resampling = std::lround(featFs) != std::lround(fs);
+    resampler rs;
+    size_t fed = 0; //g_fifo position already resampled.
+    if (resampling)
+    {
+        if (!rs.init(static_cast<uint32_t>(std::lround(fs)), static_cast<uint32_t>(std::lround(featFs)), quality) ||
+            !g_model.init(static_cast<size_t>(std::ceil(HISTORY_SECONDS * featFs))))
+        {
+            std::fprintf(stderr, "Cannot resample %.0f Hz to %.0f Hz.\n", fs, featFs);
+            return 1;
+        }
+        std::printf("Resampler: %.0f -> %.0f Hz (x%zu/%zu, %zu taps per phase, %.2f ms delay).\n", fs, featFs, rs.up,
+                    rs.down, rs.taps, rs.delay() / fs * 1000.0);
+    }
+    sampleHistory &feat = resampling ? g_model : g_fifo;
+
+    //Spectral front end on channel 0, framed on the feature history's timeline.
+    stft spec;
+    size_t winLen = static_cast<size_t>(std::lround(winMs * featFs / 1000.0));
+    size_t hopLen = static_cast<size_t>(std::lround(hopMs * featFs / 1000.0));
+    if (!spec.init(winLen, hopLen, window) || winLen + hopLen > feat.capacity())
+    {
+        std::fprintf(stderr, "Unusable STFT window/hop (%zu/%zu samples).\n", winLen, hopLen);
         return 1;
     }
+    std::printf("STFT: window %zu, hop %zu, FFT %zu (%zu bins).\n", spec.win, spec.hop, spec.nfft, spec.bins());
+    double peakHz = 0.0; //strongest bin of the latest frame.
+    int64_t stftNs = 0;
 
-    const PaDeviceInfo *di = Pa_GetDeviceInfo(in.device);
+    //Log-mel bands of each STFT frame, the classifier input.
+    melFilterbank bank;
+    if (!bank.init(static_cast<size_t>(std::max(mels, 0)), spec.nfft, featFs, fmin, fmax > 0.0 ? fmax : featFs / 2.0, scale))
+    {
+        std::fprintf(stderr, "Unusable mel filterbank (%d bands, %.0f-%.0f Hz).\n", mels, fmin, fmax);
+        return 1;
+    }
+    std::printf("Log-mel: %zu %s bands, %.0f-%.0f Hz, %zu weights (dense would be %zu).\n", bank.nMels,
+                scale == melScale::htk ? "HTK" : "Slaney", fmin, fmax > 0.0 ? fmax : featFs / 2.0, bank.nonzeros(),
+                bank.nMels * bank.bins);
+    if (bank.emptyBands() > 0)
+    {
+        std::printf("Log-mel: %zu bands cover no FFT bin and will read the floor; use fewer bands or a longer window.\n",
+                    bank.emptyBands());
+    }
+    std::vector<float> logMel(bank.nMels);
+    double melMean = 0.0; //mean log-mel energy of the latest frame.
+    int64_t melNs = 0;
 
-    in.channelCount = 1;
-    in.sampleFormat = paInt16;
-    in.suggestedLatency = di->defaultLowInputLatency;
-    in.hostApiSpecificStreamInfo = nullptr;
+    //MFCC + deltas from the same log-mel frames, for the legacy models.
+    mfcc ceps0;
+    if (!ceps0.init(bank.nMels, static_cast<size_t>(std::max(ceps, 0)), static_cast<size_t>(std::max(lifter, 0)),
+                    static_cast<size_t>(std::max(deltaN, 0)), spec.hop))
+    {
+        std::fprintf(stderr, "Unusable MFCC settings (%d cepstra from %zu bands, lifter %d, delta %d).\n", ceps,
+                     bank.nMels, lifter, deltaN);
+        return 1;
+    }
+    std::printf("MFCC: %zu-dim vectors (%zu cepstra + deltas), lag %zu frames (%.0f ms).\n", ceps0.dims(),
+                ceps0.nCeps, ceps0.lag(), ceps0.lag() * spec.hop * 1000.0 / featFs);
+    double c1 = 0.0; //c1 of the latest vector, a rough spectral tilt.
+    int64_t mfccNs = 0;
+    int64_t resampleNs = 0;
+    auto onVector = [&](const float *v, size_t)
+    {
+        c1 = ceps0.nCeps > 1 ? v[1] : v[0];
+    };
+
+    //Channel 0 feeds the history; the other lanes are metered into scratch.
+    std::vector<float> scratch(frames);
+    std::vector<levelStats> chStats(nch);
+    std::vector<levelStats> blockStats(nch); //kept only once the block proves intact.
+
+    //Started before the memory lock so its record ring is in the hot set; it only reads.
+    g_log.start(stdout);
+
+    if (rt)
+    {
+        //Everything the hot path touches, faulted in and locked while the producer is still idle.
+        realFft &fftPlan = *spec.plan;
+        const rtThread::region hot[] = {
+            //Ring, histories and resampler.
+            {g_rb.storage.data(), g_rb.storage.size()},
+            regionOf(g_rb.buf),
+            {g_rb.seq.get(), g_rb.cap * sizeof(g_rb.seq[0])},
+            {g_commitNs.data(), g_commitNs.size() * sizeof(int64_t)},
+            {g_fifo.base, 2 * g_fifo.capacity() * sizeof(float)},
+            {g_model.base, 2 * g_model.capacity() * sizeof(float)},
+            regionOf(rs.buf),
+            regionOf(rs.coeffs),
+            //Metering.
+            regionOf(scratch),
+            regionOf(chStats),
+            regionOf(blockStats),
+            //STFT and its FFT plan.
+            regionOf(spec.window),
+            regionOf(spec.frame),
+            regionOf(spec.re),
+            regionOf(spec.im),
+            regionOf(spec.power),
+            regionOf(fftPlan.stages),
+            regionOf(fftPlan.twr),
+            regionOf(fftPlan.twi),
+            regionOf(fftPlan.splitR),
+            regionOf(fftPlan.splitI),
+            regionOf(fftPlan.ar),
+            regionOf(fftPlan.ai),
+            regionOf(fftPlan.br),
+            regionOf(fftPlan.bi),
+            //Log-mel and MFCC.
+            regionOf(bank.first),
+            regionOf(bank.offset),
+            regionOf(bank.weights),
+            regionOf(logMel),
+            regionOf(ceps0.dct),
+            regionOf(ceps0.cep),
+            regionOf(ceps0.del),
+            regionOf(ceps0.starts),
+            regionOf(ceps0.out),
+            //Status lines.
+            regionOf(g_log.buf),
+        };
+        rtThread::lockMemory(hot, sizeof(hot) / sizeof(hot[0]));
+    }
 
-    double fs = di->defaultSampleRate;
-    unsigned long framesPerBuffer = 512;
+    std::vector<int> stressPids = startStress(stress);
+    if (!stressPids.empty())
+    {
+        std::printf("Stress: %zu load processes running.\n", stressPids.size());
+    }
 
-    PaStream *stream = nullptr;
+    src->start();
 
-    checkPa(Pa_OpenStream(&stream, &in, nullptr, fs, FRAMES_PER_BLOCK, paNoFlag, paCallback, nullptr), "Pa_OpenStream");
+    std::atomic<bool> stopRecord{false};
+    recordCounts recorded;
+    std::thread recorder;
+    if (recordReader != nullptr)
+    {
+        recorder = std::thread(recordBlocks, std::ref(*recordReader), recordFile, std::cref(*src), std::cref(stopRecord),
+                               std::ref(recorded));
+    }
 
-    checkPa(Pa_StartStream(stream), "Pa_StartStream");
+    if (rt)
+    {
+        //After the other threads exist, so only this one is pinned and raised.
+        int cpu = rtCpu >= 0 ? rtCpu : static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) - 1;
+        rtThread::promote(cpu, rtPrio, rtRr);
+    }
 
-    std::printf("Callback running @ %.0f Hz (block %lu).\n", fs, FRAMES_PER_BLOCK);
+    std::printf("%s running @ %.0f Hz (block %zu x %zu ch, history %zu samples ~%.0f ms).\n", file ? "File" : "Callback",
+                fs, frames, nch, g_fifo.capacity(), g_fifo.capacity() / fs * 1000.0);
 
     auto t0 = std::chrono::steady_clock::now();
     auto lastPrint = t0;
-    Block blk{};
+    const levelMeter::kernel meter = levelMeter::best(g_rb.type, frames);
+    std::printf("Level meter kernel: %s.\n", meter.name);
+
     size_t popped = 0;
+    int64_t latSumNs = 0;
+    int64_t latMaxNs = 0;
+
+    //From block metadata: gaps in seq, host-flagged blocks, deepest queue, capture-to-meter time.
+    uint64_t nextSeq = 0;
+    size_t seqGaps = 0;
+    size_t flaggedBlocks = 0;
+    uint32_t maxFill = 0;
+    size_t tornBlocks = 0; //overwritten while being read, concealed as gaps.
+    double adcLatSum = 0.0;
+    double adcLatMax = 0.0;
+    const bool realTime = file == nullptr || paced; //unpaced files run ahead of their own clock.
+
+    //The producer marks its own thread; the guard is armed after a second of audio.
+    allocGuard::markRealtime();
+    bool guardArmed = false;
+
+    //Drain whatever has piled up (up to MAX_BATCH) per wakeup; one index store releases it all.
+    constexpr size_t MAX_BATCH = 16;
+    size_t batches = 0;
 
     for (;;)
     {
-        if (!g_rb.pop(blk))
+        //done() first: blocks committed before it was set are visible to the peek after it.
+        bool drained = src->done();
+        blockSpan batch = meterReader.peekBatch(MAX_BATCH);
+        if (batch.size() == 0)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (drained)
+            {
+                break; //finite source fully drained.
+            }
+
+            if (poll)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            else
+            {
+                meterReader.waitFor(std::chrono::milliseconds(100));
+            }
         }
         else
         {
-            ++popped;
-            
-            //Computing rms values
-            double acc = 0.0;
-            constexpr double scale = 1.0/32768.0;
+            ++batches;
+            int64_t popNs = nowNs();
 
-            for (auto s : blk)
+            for (size_t b = 0; b < batch.size(); b++)
             {
-                double x = s * scale;
-                acc += x * x;
-            }
+                const Block &blk = batch[b]; //read in place, released with the batch
 
-            double rms = std::sqrt(acc/blk.size());
+                //Under overwriteOldest the producer may lap this reader and rewrite the slot
+                //mid-read. Its stamp is checked before and after; a torn block is left out
+                //and the next block's seq gap conceals it like a dropped one.
+                uint64_t seq = blk.seq;
+                double adcTime = blk.adcTime;
+                uint32_t statusFlags = blk.statusFlags;
+                uint32_t fill = blk.fill;
+                int64_t commitNs = g_commitNs[&blk - g_rb.buf.data()];
+                if (!meterReader.intact(b))
+                {
+                    ++tornBlocks;
+                    continue;
+                }
 
-            constexpr float fscale = 1.0f/32768.0f;
-            for (auto s : blk)
-            {
-                g_fifo.push_back(static_cast<float>(s) * fscale);
+                //A seq behind the timeline cannot be placed on it; the stamp should rule
+                //this out, so treat it as torn rather than trust anything in the slot.
+                if (seq < nextSeq)
+                {
+                    ++tornBlocks;
+                    continue;
+                }
+
+                //Keep the history on the capture timeline: missing blocks get concealed, not skipped.
+                if (seq > nextSeq)
+                {
+                    g_fifo.fillGap((seq - nextSeq) * frames, conceal, frames);
+                    seqGaps += seq - nextSeq;
+                    nextSeq = seq;
+                }
+
+                //Level stats and the float copy for the history in one pass, per planar lane.
+                //The history only advances over the copy once the block proves intact.
+                meter.fn(blk.rawLane(0), g_fifo.writePtr(), frames, blockStats[0]);
+                for (size_t c = 1; c < nch; c++)
+                {
+                    meter.fn(blk.rawLane(c), scratch.data(), frames, blockStats[c]);
+                }
+                if (!meterReader.intact(b))
+                {
+                    ++tornBlocks;
+                    continue;
+                }
+                g_fifo.advance(frames);
+                chStats.swap(blockStats);
+                nextSeq = seq + 1;
+
+                ++popped;
+                int64_t lat = popNs - commitNs;
+                latSumNs += lat;
+                latMaxNs = std::max(latMaxNs, lat);
+                flaggedBlocks += statusFlags != 0;
+                maxFill = std::max(maxFill, fill);
+
+                if (resampling)
+                {
+                    int64_t r0 = nowNs();
+                    feedModel(rs, fed, frames);
+                    resampleNs += nowNs() - r0;
+                }
+
+                int64_t s0 = nowNs();
+                spec.update(feat, [&](const stftFrame &f)
+                {
+                    size_t best = std::max_element(f.power + 1, f.power + f.bins) - f.power;
+                    peakHz = best * featFs / spec.nfft;
+
+                    int64_t m0 = nowNs();
+                    bank.apply(f.power, logMel.data());
+                    melLog::apply(logMel.data(), logMel.data(), logMel.size(), 1e-10f);
+                    melNs += nowNs() - m0;
+                    melMean = std::accumulate(logMel.begin(), logMel.end(), 0.0) / logMel.size();
+
+                    int64_t c0 = nowNs();
+                    ceps0.push(logMel.data(), f.start, onVector);
+                    mfccNs += nowNs() - c0;
+                });
+                stftNs += nowNs() - s0;
+
+                if (realTime)
+                {
+                    //The block's last frame was captured one block after its first.
+                    double adcLat = src->streamTime() - (adcTime + frames / fs);
+                    adcLatSum += adcLat;
+                    adcLatMax = std::max(adcLatMax, adcLat);
+                }
             }
+            meterReader.releaseBatch(batch.size()); //torn blocks were already left out above.
 
-            //Keeping FIFO bounded
-            while (g_fifo.size() > FIFO_MAX)
+            if (allocCheck && !guardArmed && popped * frames >= fs)
             {
-                g_fifo.pop_front();
+                allocGuard::arm(allocAbort);
+                guardArmed = true;
             }
 
+            const levelStats &st = chStats[0];
+            double rms = st.rms();
             double ms = (g_fifo.size()/fs) * 1000.0;
 
             auto now = std::chrono::steady_clock::now();
             if (std::chrono::duration_cast<std::chrono::milliseconds>(now - lastPrint).count() >= 100)
             {
-                std::printf("RMS: %.6f | FIFO: %zu(~%.0f ms)\n", rms, g_fifo.size(), ms);
+                g_log.write("RMS: %.6f | peak: %.4f | DC: %+.5f | FIFO: %zu(~%.0f ms) | STFT peak: %.0f Hz | log-mel: %.1f | c1: %+.1f\n",
+                            rms, st.peakLevel(), st.dc(), g_fifo.size(), ms, peakHz, melMean, c1);
+                for (size_t c = 0; nch > 1 && c < nch; c += 7)
+                {
+                    auto r = [&](size_t k) { return c + k < nch ? chStats[c + k].rms() : 0.0; };
+                    g_log.write(CHANNEL_RMS_FMT[std::min<size_t>(7, nch - c)], c, r(0), r(1), r(2), r(3), r(4), r(5),
+                                r(6));
+                }
                 lastPrint = now;
             }
             
-            if (std::chrono::duration_cast<std::chrono::seconds>(now - t0).count() >= 5)
+            //Live capture runs for 5 s; files run to the end.
+            if (file == nullptr && std::chrono::duration_cast<std::chrono::seconds>(now - t0).count() >= 5)
             {
                 break;
             }
         }        
     }
 
-    std::printf("Dropped blocks (callback): %zu.\n", g_rb.dropped.load());
+    allocGuard::disarm();
+    g_log.stop(); //flush status lines before the summary.
+    stopRecord.store(true, std::memory_order_relaxed);
+    g_rb.wakeReaders();
+    if (recorder.joinable())
+    {
+        recorder.join();
+        std::fclose(recordFile);
+        std::printf("Recorded %zu frames to %s (%zu blocks of silence for gaps, %zu torn).\n", recorded.frames,
+                    recordPath, recorded.gapBlocks, recorded.torn);
+    }
 
-    checkPa(Pa_StopStream(stream), "Pa_StopStream");
-    checkPa(Pa_CloseStream(stream), "Pa_CloseStream");
+    stopStress(stressPids);
 
-    Pa_Terminate();
+    std::printf("Dropped blocks (callback): %zu (%zu frames)%s | log records dropped: %zu.\n", g_rb.dropped.load(),
+                src->reblock.framesDropped.load(), stressPids.empty() ? "" : " under stress", g_log.dropped.load());
+    if (policy == overflowPolicy::overwriteOldest)
+    {
+        std::printf("Overwritten blocks: %zu | meter lost %zu, torn %zu (concealed).\n", g_rb.overwritten.load(),
+                    meterReader.lost.load(), tornBlocks);
+    }
+    if (popped > 0)
+    {
+        std::printf("Popped %zu blocks in %zu batches (%.1f per wakeup).\n", popped, batches,
+                    static_cast<double>(popped) / batches);
+        std::printf("Callback-to-pop latency (%s): avg %.1f us | max %.1f us.\n", poll ? "poll" : "wait",
+                    latSumNs / 1000.0 / popped, latMaxNs / 1000.0);
+        std::printf("Sequence gaps: %zu blocks (concealed, timeline at %zu samples) | host-flagged blocks: %zu | "
+                    "max ring fill: %u/%zu.\n", seqGaps, g_fifo.written, flaggedBlocks, maxFill, g_rb.cap);
+        if (realTime)
+        {
+            std::printf("Capture-to-meter latency: avg %.2f ms | max %.2f ms.\n", adcLatSum * 1000.0 / popped,
+                        adcLatMax * 1000.0);
+        }
+    }
+
+    if (resampling)
+    {
+        std::printf("Resampler: %zu -> %zu samples, %.2f us per block.\n", g_fifo.written, g_model.written,
+                    popped > 0 ? resampleNs / 1000.0 / popped : 0.0);
+    }
+    std::printf("STFT: %zu frames (%zu skipped at gaps), %.2f us per frame.\n", spec.produced, spec.skipped,
+                spec.produced > 0 ? (stftNs - melNs - mfccNs) / 1000.0 / spec.produced : 0.0);
+    std::printf("Log-mel: %.2f us per frame (filterbank + log).\n",
+                spec.produced > 0 ? melNs / 1000.0 / spec.produced : 0.0);
+    ceps0.flush(onVector);
+    std::printf("MFCC: %zu vectors of %zu (%zu restarts at gaps), %.2f us per frame.\n", ceps0.emitted, ceps0.dims(),
+                ceps0.restarts, spec.produced > 0 ? mfccNs / 1000.0 / spec.produced : 0.0);
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("Processed %.2f s of audio in %.2f s (real-time factor %.1fx).\n", popped * frames / fs, wall,
+                wall > 0 ? popped * frames / fs / wall : 0.0);
+
+    src->stop();
+
+    if (allocCheck)
+    {
+        std::printf("Real-time heap calls after warm-up: %zu.\n", allocGuard::count());
+        if (!guardArmed || allocGuard::count() != 0)
+        {
+            std::fprintf(stderr, "Allocation check FAILED%s.\n", guardArmed ? "" : " (run too short to warm up)");
+            return 1;
+        }
+    }
     return 0;
 }
\ No newline at end of file
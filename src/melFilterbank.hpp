@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "fft.hpp"
+
+enum class melScale
+{
+    htk, //2595 log10(1 + f/700), filters peak at 1.
+    slaney, //linear below 1 kHz, log above; filters normalised to equal area.
+};
+
+// Triangular mel filterbank over the power spectrum of an nfft-point frame.
+// Each filter is stored as its first nonzero bin plus a run of weights, so
+// apply() costs one multiply-add per nonzero weight (about two per bin in
+// total) instead of a dense bins x nMels product.
+struct melFilterbank
+{
+    size_t nMels = 0;
+    size_t bins = 0; //nfft/2 + 1
+    melScale scale = melScale::slaney;
+    std::vector<uint32_t> first; //first bin of filter m.
+    std::vector<uint32_t> offset; //filter m's weights are weights[offset[m] .. offset[m + 1]).
+    std::vector<float> weights;
+
+    static double toMel(double hz, melScale s)
+    {
+        if (s == melScale::htk)
+        {
+            return 2595.0 * std::log10(1.0 + hz / 700.0);
+        }
+        const double step = 200.0 / 3.0; //Hz per mel below 1 kHz.
+        return hz < 1000.0 ? hz / step : 1000.0 / step + std::log(hz / 1000.0) / (std::log(6.4) / 27.0);
+    }
+
+    static double toHz(double mel, melScale s)
+    {
+        if (s == melScale::htk)
+        {
+            return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+        }
+        const double step = 200.0 / 3.0;
+        const double knee = 1000.0 / step;
+        return mel < knee ? mel * step : 1000.0 * std::exp((mel - knee) * (std::log(6.4) / 27.0));
+    }
+
+    // Filters centred on nMels points evenly spaced in mel between fmin and
+    // fmax (Hz). Returns false if the band is empty or beyond Nyquist.
+    bool init(size_t mels, size_t nfft, double fs, double fmin, double fmax, melScale s)
+    {
+        if (mels == 0 || nfft < 2 || fmin < 0.0 || fmax <= fmin || fmax > fs / 2.0 + 1e-6)
+        {
+            return false;
+        }
+        nMels = mels;
+        bins = nfft / 2 + 1;
+        scale = s;
+
+        //nMels + 2 edges: filter m rises from edge m to m + 1 and falls to m + 2.
+        std::vector<double> edge(nMels + 2);
+        double lo = toMel(fmin, s), hi = toMel(fmax, s);
+        for (size_t i = 0; i < edge.size(); i++)
+        {
+            edge[i] = toHz(lo + (hi - lo) * static_cast<double>(i) / static_cast<double>(nMels + 1), s);
+        }
+
+        first.assign(nMels, 0);
+        offset.assign(nMels + 1, 0);
+        weights.clear();
+        for (size_t m = 0; m < nMels; m++)
+        {
+            double norm = s == melScale::slaney ? 2.0 / (edge[m + 2] - edge[m]) : 1.0;
+            size_t begin = bins, end = 0;
+            std::vector<float> w(bins, 0.0f);
+            for (size_t k = 0; k < bins; k++)
+            {
+                double f = static_cast<double>(k) * fs / static_cast<double>(nfft);
+                double up = (f - edge[m]) / (edge[m + 1] - edge[m]);
+                double down = (edge[m + 2] - f) / (edge[m + 2] - edge[m + 1]);
+                double v = std::max(0.0, std::min(up, down)) * norm;
+                if (v > 0.0)
+                {
+                    w[k] = static_cast<float>(v);
+                    begin = std::min(begin, k);
+                    end = k + 1;
+                }
+            }
+
+            //A filter narrower than a bin spacing can miss every bin; it stays empty and reads 0.
+            first[m] = static_cast<uint32_t>(begin < end ? begin : 0);
+            if (begin < end)
+            {
+                weights.insert(weights.end(), w.begin() + begin, w.begin() + end);
+            }
+            offset[m + 1] = static_cast<uint32_t>(weights.size());
+        }
+        return true;
+    }
+
+    // out[m] = sum of power[k] * weight over filter m's nonzero bins.
+    void apply(const float *power, float *out) const
+    {
+        for (size_t m = 0; m < nMels; m++)
+        {
+            const float *w = weights.data() + offset[m];
+            const float *p = power + first[m];
+            size_t n = offset[m + 1] - offset[m];
+            float acc = 0.0f;
+            for (size_t i = 0; i < n; i++)
+            {
+                acc += p[i] * w[i];
+            }
+            out[m] = acc;
+        }
+    }
+
+    // Filters that cover no bin: too many bands for this FFT size.
+    size_t emptyBands() const
+    {
+        size_t n = 0;
+        for (size_t m = 0; m < nMels; m++)
+        {
+            n += offset[m + 1] == offset[m];
+        }
+        return n;
+    }
+
+    // Nonzero weights, i.e. multiply-adds per frame.
+    size_t nonzeros() const
+    {
+        return weights.size();
+    }
+};
+
+namespace melLog
+{
+    //Cephes logf: split x = 2^e * m with m in [sqrt(1/2), sqrt(2)), then a
+    //degree-9 polynomial in m - 1. About 1 ulp over the normal range.
+    constexpr float C[9] = {7.0376836292e-2f, -1.1514610310e-1f, 1.1676998740e-1f,
+                            -1.2420140846e-1f, 1.4249322787e-1f, -1.6668057665e-1f,
+                            2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f};
+    constexpr float LN2 = 0.693147180559945f;
+
+    inline float scalar(float x)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        float e = static_cast<float>(static_cast<int32_t>(bits >> 23) - 127);
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+        if (m > 1.41421356f)
+        {
+            m *= 0.5f;
+            e += 1.0f;
+        }
+        float f = m - 1.0f;
+        float z = f * f;
+        float y = C[0];
+        for (size_t i = 1; i < 9; i++)
+        {
+            y = y * f + C[i];
+        }
+        return f + (y * f * z - 0.5f * z) + e * LN2;
+    }
+
+    // dst[i] = ln(max(src[i], floor)); floor must be a positive normal float.
+    // In place is fine.
+    inline void apply(const float *src, float *dst, size_t n, float floor)
+    {
+        size_t i = 0;
+#if defined(FFT_SSE2)
+        const __m128 lo = _mm_set1_ps(floor);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 sqrt2 = _mm_set1_ps(1.41421356f);
+        const __m128i mant = _mm_set1_epi32(0x007fffff);
+        const __m128i bias = _mm_set1_epi32(0x3f800000);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 x = _mm_max_ps(_mm_loadu_ps(src + i), lo);
+            __m128i bits = _mm_castps_si128(x);
+            __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+            __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, mant), bias));
+
+            __m128 big = _mm_cmpgt_ps(m, sqrt2);
+            m = _mm_or_ps(_mm_and_ps(big, _mm_mul_ps(m, half)), _mm_andnot_ps(big, m));
+            e = _mm_add_ps(e, _mm_and_ps(big, one));
+
+            __m128 f = _mm_sub_ps(m, one);
+            __m128 z = _mm_mul_ps(f, f);
+            __m128 y = _mm_set1_ps(C[0]);
+            for (size_t c = 1; c < 9; c++)
+            {
+                y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(C[c]));
+            }
+            y = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(y, f), z), _mm_mul_ps(half, z));
+            y = _mm_add_ps(_mm_add_ps(f, y), _mm_mul_ps(e, _mm_set1_ps(LN2)));
+            _mm_storeu_ps(dst + i, y);
+        }
+#endif
+        for (; i < n; i++)
+        {
+            dst[i] = scalar(std::max(src[i], floor));
+        }
+    }
+}
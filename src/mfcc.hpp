@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fft.hpp"
+
+// MFCCs with first and second order deltas from a stream of log-mel frames.
+// The DCT-II (orthonormal, lifter folded in) is a precomputed matrix stored
+// mel-major and padded to whole vectors, so each mel band adds one broadcast
+// multiply into four cepstra at a time. Deltas use the regression formula
+//   d[t] = sum_{n=1..N} n (c[t+n] - c[t-n]) / (2 sum n^2)
+// over small rings of past frames; a frame's full vector is ready 2N frames
+// after it arrives (N look-ahead for the delta, N more for the delta-delta).
+// Stream edges are padded by repeating the first or last frame.
+struct mfcc
+{
+    size_t nMels = 0;
+    size_t nCeps = 0;
+    size_t width = 0; //nCeps rounded up to whole vectors.
+    size_t deltaN = 0; //look-back/look-ahead of each delta stage, frames.
+    size_t hop = 0; //expected timeline step between frames; anything else restarts the stream.
+    float norm = 1.0f; //1 / (2 sum n^2)
+    std::vector<float> dct; //nMels x width; dct[m * width + n] * lifter[n]
+    std::vector<float> cep, del; //rings of 2N + 1 frames, width apart.
+    std::vector<size_t> starts; //timeline position of each frame in cep.
+    std::vector<float> out; //3 * nCeps: c, delta, delta-delta.
+
+    size_t received = 0; //frames since the stream (re)started.
+    size_t lastStart = 0;
+    size_t emitted = 0;
+    size_t restarts = 0;
+
+    // lifter 0 disables liftering. Returns false if the sizes are unusable.
+    bool init(size_t mels, size_t ceps, size_t lifter, size_t n, size_t hopLen)
+    {
+        if (mels == 0 || ceps == 0 || ceps > mels || n == 0 || hopLen == 0)
+        {
+            return false;
+        }
+        nMels = mels;
+        nCeps = ceps;
+        width = (ceps + 3) / 4 * 4;
+        deltaN = n;
+        hop = hopLen;
+
+        double sum = 0.0;
+        for (size_t i = 1; i <= n; i++)
+        {
+            sum += static_cast<double>(i * i);
+        }
+        norm = static_cast<float>(1.0 / (2.0 * sum));
+
+        dct.assign(nMels * width, 0.0f);
+        for (size_t k = 0; k < nCeps; k++)
+        {
+            double lift = lifter > 0 ? 1.0 + 0.5 * lifter * std::sin(fft::PI * k / lifter) : 1.0;
+            double scale = std::sqrt((k == 0 ? 1.0 : 2.0) / nMels) * lift;
+            for (size_t m = 0; m < nMels; m++)
+            {
+                dct[m * width + k] = static_cast<float>(scale * std::cos(fft::PI * k * (2.0 * m + 1.0) / (2.0 * nMels)));
+            }
+        }
+
+        cep.assign(ring() * width, 0.0f);
+        del.assign(ring() * width, 0.0f);
+        starts.assign(ring(), 0);
+        out.assign(3 * nCeps, 0.0f);
+        received = 0;
+        emitted = 0;
+        restarts = 0;
+        return true;
+    }
+
+    size_t dims() const
+    {
+        return 3 * nCeps;
+    }
+
+    // Frames between a frame's arrival and its feature vector.
+    size_t lag() const
+    {
+        return 2 * deltaN;
+    }
+
+    // Adds the log-mel frame that starts at timeline position start. Runs
+    // onVector(const float *features, size_t start) for each frame whose
+    // vector is now complete. A frame off the hop grid (frames were skipped
+    // over a gap) first flushes the old stream, so deltas never span a gap.
+    template <class F>
+    void push(const float *logMel, size_t start, F &&onVector)
+    {
+        if (received > 0 && start != lastStart + hop)
+        {
+            flush(onVector);
+            ++restarts;
+        }
+
+        transform(logMel, slot(cep, received));
+        starts[received % ring()] = start;
+        lastStart = start;
+        step(received, onVector);
+        ++received;
+    }
+
+    // Pads the stream end with copies of the last frame to emit the vectors
+    // still waiting on look-ahead, then starts a new stream.
+    template <class F>
+    void flush(F &&onVector)
+    {
+        if (received == 0)
+        {
+            return;
+        }
+        size_t last = received - 1;
+        for (size_t t = received; t < received + lag(); t++)
+        {
+            std::copy_n(slot(cep, last), width, slot(cep, t));
+            step(t, onVector, received);
+        }
+        received = 0;
+    }
+
+private:
+    size_t ring() const
+    {
+        return 2 * deltaN + 1;
+    }
+
+    float *slot(std::vector<float> &r, size_t t)
+    {
+        return r.data() + (t % ring()) * width;
+    }
+
+    // Slot of frame t clamped to the stream start, which stands in for earlier frames.
+    const float *clamped(std::vector<float> &r, long t)
+    {
+        return slot(r, static_cast<size_t>(std::max(t, 0L)));
+    }
+
+    void transform(const float *x, float *c) const
+    {
+        using fft::vec4;
+        for (size_t k = 0; k < width; k += vec4::WIDTH)
+        {
+            vec4 acc = vec4::set(0.0f);
+            for (size_t m = 0; m < nMels; m++)
+            {
+                acc = acc + vec4::load(&dct[m * width + k]) * vec4::set(x[m]);
+            }
+            acc.store(c + k);
+        }
+    }
+
+    void regress(std::vector<float> &r, long t, float *d)
+    {
+        std::fill_n(d, width, 0.0f);
+        for (size_t n = 1; n <= deltaN; n++)
+        {
+            const float *ahead = clamped(r, t + static_cast<long>(n));
+            const float *behind = clamped(r, t - static_cast<long>(n));
+            float w = static_cast<float>(n) * norm;
+            for (size_t k = 0; k < width; k++)
+            {
+                d[k] += w * (ahead[k] - behind[k]);
+            }
+        }
+    }
+
+    // Cepstrum t is in place: finish delta t - N, then delta-delta t - 2N,
+    // and emit that frame if it is real (below end).
+    template <class F>
+    void step(size_t t, F &onVector, size_t end = SIZE_MAX)
+    {
+        const long N = static_cast<long>(deltaN);
+        long d = static_cast<long>(t) - N;
+        if (d < 0)
+        {
+            return;
+        }
+        if (static_cast<size_t>(d) < end)
+        {
+            regress(cep, d, slot(del, static_cast<size_t>(d)));
+        }
+        else
+        {
+            std::copy_n(slot(del, end - 1), width, slot(del, static_cast<size_t>(d))); //past the end: repeat the last delta.
+        }
+
+        long v = d - N;
+        if (v < 0 || static_cast<size_t>(v) >= end)
+        {
+            return;
+        }
+        const float *c = slot(cep, static_cast<size_t>(v));
+        const float *dv = slot(del, static_cast<size_t>(v));
+        float *dd = out.data() + 2 * nCeps;
+        for (size_t k = 0; k < nCeps; k++)
+        {
+            out[k] = c[k];
+            out[nCeps + k] = dv[k];
+            dd[k] = 0.0f;
+        }
+        for (size_t n = 1; n <= deltaN; n++)
+        {
+            const float *ahead = clamped(del, v + static_cast<long>(n));
+            const float *behind = clamped(del, v - static_cast<long>(n));
+            float w = static_cast<float>(n) * norm;
+            for (size_t k = 0; k < nCeps; k++)
+            {
+                dd[k] += w * (ahead[k] - behind[k]);
+            }
+        }
+
+        ++emitted;
+        onVector(static_cast<const float *>(out.data()), starts[static_cast<size_t>(v) % ring()]);
+    }
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <portaudio.h>
+#include <cstdio>
+#include <cstdlib>
+
+#include "allocGuard.hpp"
+#include "audioSource.hpp"
+
+inline void checkPa(PaError e, const char *where)
+{
+    if (e != paNoError)
+    {
+        std::fprintf(stderr, "PortAudio error at %s: %s\n", where, Pa_GetErrorText(e));
+        std::exit(1);
+    }
+}
+
+// Live capture of nChannels from the default input device. PortAudio converts
+// formats internally, so Pa_IsFormatSupported() accepts nearly anything and
+// cannot reveal what the driver natively delivers. Without an explicit format
+// this takes float32, PortAudio's own working format and the native one on
+// most desktop hosts, falling back to int32, int16, then int24; pass the
+// format to match an integer-native device exactly.
+struct paSource : audioSource
+{
+    PaStream *stream = nullptr;
+    double fs = 0.0;
+    int nChannels = 1;
+    PaSampleFormat wanted = 0; //0 = negotiate.
+    PaSampleFormat format = paInt16;
+    std::atomic<size_t> overflows{0}; //callbacks flagged paInputOverflow: the host lost input.
+
+    paSource(broadcastRing &ring, int channels, PaSampleFormat fmt) : audioSource(ring), nChannels(channels), wanted(fmt) {}
+
+    static const char *formatName(PaSampleFormat f)
+    {
+        return f == paFloat32 ? "float32" : f == paInt32 ? "int32" : f == paInt24 ? "int24" : "int16";
+    }
+
+    ~paSource() override
+    {
+        if (stream != nullptr)
+        {
+            Pa_CloseStream(stream);
+        }
+        Pa_Terminate();
+    }
+
+    // PortAudio Callback
+    static int paCallback(const void *input, void *, unsigned long frames,
+                          const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags,
+                          void *user)
+    {
+        allocGuard::markRealtime();
+        auto *self = static_cast<paSource *>(user);
+        if ((statusFlags & paInputOverflow) != 0)
+        {
+            //Audio was lost before this buffer; the flag also rides on the block it lands in.
+            self->overflows.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (input == nullptr)
+        {
+            return paContinue;
+        }
+
+        //Any buffer size from the host is re-cut into exact blocks in the ring.
+        double adc = timeInfo != nullptr ? timeInfo->inputBufferAdcTime : 0.0;
+        self->reblock.write(input, frames, adc, static_cast<uint32_t>(statusFlags)); //drops are counted in the ring
+        return paContinue;
+    }
+
+    bool open() override
+    {
+        checkPa(Pa_Initialize(), "Pa_Initialize");
+
+        int n = Pa_GetDeviceCount();
+
+        if (n < 0)
+        {
+            std::fprintf(stderr, "Pa_GetDeviceCount error: %s\n", Pa_GetErrorText(n));
+            return false;
+        }
+
+        std::printf("\nAudio devices: %d\n", n);
+
+        for (int i = 0; i < n; i++)
+        {
+            const PaDeviceInfo *di = Pa_GetDeviceInfo(i);
+            const PaHostApiInfo *hai = Pa_GetHostApiInfo(di->hostApi);
+            std::printf("[%2d] %-36s | Api: %-12s | in:%2d out:%2d | default SR: %.0f\n", i, di->name,
+                                                                                        hai->name, di->maxInputChannels,
+                                                                                        di->maxOutputChannels, di->defaultSampleRate);
+        }
+
+        PaStreamParameters in{};
+        in.device = Pa_GetDefaultInputDevice();
+
+        if (in.device == paNoDevice)
+        {
+            std::fprintf(stderr, "No default input device.\n");
+            return false;
+        }
+
+        const PaDeviceInfo *di = Pa_GetDeviceInfo(in.device);
+
+        if (di->maxInputChannels < nChannels)
+        {
+            std::fprintf(stderr, "Default input has %d channels, %d requested.\n", di->maxInputChannels, nChannels);
+            return false;
+        }
+
+        in.channelCount = nChannels;
+        in.suggestedLatency = di->defaultLowInputLatency;
+        in.hostApiSpecificStreamInfo = nullptr;
+
+        fs = di->defaultSampleRate;
+
+        const PaSampleFormat prefs[] = {paFloat32, paInt32, paInt16, paInt24};
+        bool found = false;
+        for (PaSampleFormat f : prefs)
+        {
+            if (wanted != 0 && f != wanted)
+            {
+                continue;
+            }
+
+            in.sampleFormat = f;
+            if (Pa_IsFormatSupported(&in, nullptr, fs) == paFormatIsSupported)
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            std::fprintf(stderr, "No supported input sample format.\n");
+            return false;
+        }
+
+        format = in.sampleFormat;
+        reblock.packed24 = format == paInt24;
+        std::printf("Input format: %s.\n", formatName(format));
+
+        //Let the host pick its preferred buffer size; the callback re-blocks.
+        checkPa(Pa_OpenStream(&stream, &in, nullptr, fs, paFramesPerBufferUnspecified, paNoFlag, paCallback, this),
+                "Pa_OpenStream");
+
+        //Report the rate the stream actually negotiated.
+        const PaStreamInfo *si = Pa_GetStreamInfo(stream);
+        if (si != nullptr && si->sampleRate > 0)
+        {
+            fs = si->sampleRate;
+        }
+        reblock.rate = fs;
+
+        return true;
+    }
+
+    bool start() override
+    {
+        checkPa(Pa_StartStream(stream), "Pa_StartStream");
+        return true;
+    }
+
+    void stop() override
+    {
+        checkPa(Pa_StopStream(stream), "Pa_StopStream");
+    }
+
+    double sampleRate() const override
+    {
+        return fs;
+    }
+
+    size_t channelCount() const override
+    {
+        return static_cast<size_t>(nChannels);
+    }
+
+    double streamTime() const override
+    {
+        return Pa_GetStreamTime(stream);
+    }
+
+    sampleType laneType() const override
+    {
+        return format == paFloat32 ? sampleType::f32 : format == paInt16 ? sampleType::i16 : sampleType::i32;
+    }
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "broadcastRing.hpp"
+#include "deinterleave.hpp"
+
+// Producer-side adapter: accepts whatever frame count the driver delivers and
+// publishes exact ring-sized blocks into the ring, filling slots in place.
+// Input is interleaved in the ring's sample type (or packed 24-bit feeding an
+// int32 ring); it is deinterleaved into the slot's planar lanes.
+struct reblocker
+{
+    broadcastRing &rb;
+    Block *pending = nullptr; //claimed slot being filled.
+    size_t fill = 0; //frames already in pending.
+    size_t skip = 0; //frames left to discard after a failed claim.
+    bool packed24 = false; //input is 3-byte samples, widened into i32 lanes.
+    double rate = 0.0; //frames per second, to time blocks that start mid-buffer.
+    uint32_t flags = 0; //status flags not yet attached to a published block.
+    std::atomic<size_t> framesDropped{0};
+    void (*onFull)(const Block *) = [](const Block *) {}; //runs just before a full block is published.
+
+    explicit reblocker(broadcastRing &ring) : rb(ring) {}
+
+    // adcTime is the capture time of input's first frame and statusFlags the
+    // host's flags for it; both travel with the blocks they end up in.
+    // Returns the number of whole blocks committed.
+    size_t write(const void *input, size_t frames, double adcTime = 0.0, uint32_t statusFlags = 0)
+    {
+        size_t committed = 0;
+        const unsigned char *src = static_cast<const unsigned char *>(input);
+        const size_t frameBytes = rb.channels * (packed24 ? 3 : sampleBytes(rb.type));
+        const size_t total = frames;
+        flags |= statusFlags;
+
+        while (frames > 0)
+        {
+            if (skip > 0)
+            {
+                //Ring was full: throw away one block's worth so block boundaries stay aligned.
+                size_t k = std::min(skip, frames);
+                skip -= k;
+                frames -= k;
+                src += k * frameBytes;
+                framesDropped.fetch_add(k, std::memory_order_relaxed);
+                continue;
+            }
+
+            if (pending == nullptr)
+            {
+                pending = rb.claim(); //counts a dropped block when full
+                if (pending == nullptr)
+                {
+                    skip = rb.frames;
+                    continue;
+                }
+                fill = 0;
+                pending->adcTime = rate > 0 ? adcTime + (total - frames) / rate : adcTime;
+            }
+
+            size_t k = std::min(pending->size() - fill, frames);
+            put(src, k);
+            fill += k;
+            frames -= k;
+            src += k * frameBytes;
+
+            if (fill == pending->size())
+            {
+                pending->statusFlags = flags;
+                flags = 0;
+                onFull(pending);
+                rb.commit();
+                pending = nullptr;
+                ++committed;
+            }
+        }
+
+        return committed;
+    }
+
+private:
+    // Deinterleave k frames into pending's lanes at offset fill.
+    void put(const unsigned char *src, size_t k)
+    {
+        const size_t stride = pending->size();
+        if (packed24)
+        {
+            deinterleave::run24(src, rb.channels, k, pending->lane<int32_t>(0) + fill, stride);
+        }
+        else if (rb.type == sampleType::i16)
+        {
+            deinterleave::run(reinterpret_cast<const int16_t *>(src), rb.channels, k, pending->lane<int16_t>(0) + fill,
+                              stride);
+        }
+        else
+        {
+            deinterleave::run32(reinterpret_cast<const uint32_t *>(src), rb.channels, k,
+                                pending->lane<uint32_t>(0) + fill, stride);
+        }
+    }
+};
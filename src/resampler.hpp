@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "fft.hpp"
+
+// Filter length and stopband per resampler preset. Lengths are per period of
+// the lower rate; decimating filters get proportionally more input taps.
+enum class resampleQuality
+{
+    fast, //16 taps, ~54 dB stopband, passband to ~80% of the lower Nyquist.
+    medium, //32 taps, ~81 dB, ~84%.
+    best, //64 taps, ~99 dB, ~90%.
+};
+
+// Streaming polyphase resampler for a rational ratio up/down (the rates'
+// ratio reduced by their gcd). The windowed-sinc prototype is designed once
+// by init() and split into `up` phases of `taps` coefficients, stored
+// reversed so every output is one contiguous SIMD dot product against the
+// input. Input is consumed in any block size; the last taps - 1 samples are
+// carried between calls, so block boundaries leave no trace in the output.
+struct resampler
+{
+    size_t up = 1; //L: output rate / gcd.
+    size_t down = 1; //M: input rate / gcd.
+    size_t taps = 0; //per phase, a multiple of four.
+    std::vector<float> coeffs; //up phases x taps.
+    std::vector<float> buf; //taps - 1 carried samples, then up to CHUNK new ones.
+    size_t held = 0; //samples in buf.
+    size_t next = 0; //buf index of the newest input sample the next output needs.
+    size_t phase = 0; //phase of the next output, 0..up-1.
+
+    static constexpr size_t CHUNK = 1024; //input samples per pass.
+    static constexpr size_t MAX_PHASES = 4096;
+
+    // Returns false for rates whose reduced ratio needs more than MAX_PHASES
+    // phases (e.g. 44100 -> 16001).
+    bool init(uint32_t inRate, uint32_t outRate, resampleQuality q)
+    {
+        if (inRate == 0 || outRate == 0)
+        {
+            return false;
+        }
+        uint32_t g = std::gcd(inRate, outRate);
+        up = outRate / g;
+        down = inRate / g;
+        if (up > MAX_PHASES)
+        {
+            return false;
+        }
+
+        size_t base;
+        double beta;
+        switch (q)
+        {
+        case resampleQuality::fast: base = 16; beta = 5.0; break;
+        case resampleQuality::medium: base = 32; beta = 8.0; break;
+        default: base = 64; beta = 10.0; break;
+        }
+        taps = static_cast<size_t>(std::ceil(static_cast<double>(base * std::max(up, down)) / up));
+        taps = (taps + 3) / 4 * 4;
+
+        //Kaiser's estimate of the transition width for this stopband and
+        //length, in units of the lower rate; it ends right at that rate's Nyquist.
+        double atten = beta / 0.1102 + 8.7;
+        double transition = (atten - 7.95) / (14.36 * static_cast<double>(base));
+
+        //Prototype at the upsampled rate, gain up.
+        size_t len = up * taps;
+        double fc = (0.5 - 0.5 * transition) / static_cast<double>(std::max(up, down)); //cycles per upsampled sample.
+        double mid = 0.5 * static_cast<double>(len - 1);
+        double norm = 1.0 / besselI0(beta);
+        coeffs.assign(len, 0.0f);
+        for (size_t j = 0; j < len; j++)
+        {
+            double t = static_cast<double>(j) - mid;
+            double sinc = t == 0.0 ? 2.0 * fc : std::sin(2.0 * fft::PI * fc * t) / (fft::PI * t);
+            double r = t / mid;
+            double w = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) * norm;
+            //Phase p holds taps p, p + up, p + 2 up, ..., newest input last.
+            size_t p = j % up, k = j / up;
+            coeffs[p * taps + (taps - 1 - k)] = static_cast<float>(sinc * w * static_cast<double>(up));
+        }
+
+        buf.assign(taps - 1 + CHUNK, 0.0f);
+        reset();
+        return true;
+    }
+
+    // Forgets the carried input; the next block starts from silence.
+    void reset()
+    {
+        held = taps - 1;
+        std::fill(buf.begin(), buf.begin() + held, 0.0f);
+        next = taps - 1;
+        phase = 0;
+    }
+
+    // Upper bound on the outputs process() returns for n inputs.
+    size_t maxOutput(size_t n) const
+    {
+        return (n * up + down - 1) / down + 1;
+    }
+
+    // Input samples between an input instant and the output that centres on it.
+    double delay() const
+    {
+        return 0.5 * static_cast<double>(up * taps - 1) / static_cast<double>(up);
+    }
+
+    // Accounts for n input samples of silence without filtering them, e.g. a
+    // gap too long to still be held upstream. Returns how many outputs they
+    // would have produced; the caller stands in that many zeros.
+    size_t skip(size_t n)
+    {
+        size_t end = held + n;
+        size_t count = 0;
+        if (end > next)
+        {
+            count = ((end - next) * up - phase + down - 1) / down;
+        }
+        size_t pos = phase + count * down;
+        next += pos / up;
+        phase = pos % up;
+
+        //The carried samples are now the tail of (buf + n zeros).
+        size_t keep = taps - 1;
+        for (size_t i = 0; i < keep; i++)
+        {
+            size_t from = end - keep + i;
+            buf[i] = from < held ? buf[from] : 0.0f;
+        }
+        next -= end - keep;
+        held = keep;
+        return count;
+    }
+
+    // First output (counting from init() or reset()) whose filter support
+    // starts at or after input sample pos.
+    size_t firstOutputAfter(size_t pos) const
+    {
+        return ((pos + taps - 1) * up + down - 1) / down;
+    }
+
+    // Consumes n input samples and writes the outputs they complete to out,
+    // which needs maxOutput(n) floats. Returns how many were written.
+    size_t process(const float *in, size_t n, float *out)
+    {
+        size_t produced = 0;
+        while (n > 0)
+        {
+            size_t k = std::min(n, CHUNK);
+            std::copy_n(in, k, buf.data() + held);
+            held += k;
+            in += k;
+            n -= k;
+
+            while (next < held)
+            {
+                out[produced++] = dot(coeffs.data() + phase * taps, buf.data() + next + 1 - taps);
+                phase += down;
+                next += phase / up;
+                phase %= up;
+            }
+
+            //Keep the last taps - 1 samples for the next pass.
+            size_t keep = taps - 1;
+            std::copy(buf.begin() + (held - keep), buf.begin() + held, buf.begin());
+            next -= held - keep;
+            held = keep;
+        }
+        return produced;
+    }
+
+private:
+    float dot(const float *h, const float *x) const
+    {
+        using fft::vec4;
+        vec4 acc = vec4::set(0.0f);
+        for (size_t i = 0; i < taps; i += vec4::WIDTH)
+        {
+            acc = acc + vec4::load(h + i) * vec4::load(x + i);
+        }
+        float lanes[4];
+        acc.store(lanes);
+        float s = lanes[0];
+        for (size_t i = 1; i < vec4::WIDTH; i++)
+        {
+            s += lanes[i];
+        }
+        return s;
+    }
+
+    static double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 50 && term > 1e-12 * sum; k++)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+};
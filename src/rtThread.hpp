@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define RT_THREAD_POSIX 1
+#endif
+
+// Opt-in real-time hardening for the processing thread. Every step is best
+// effort: it reports what it applied and why anything else was refused
+// (usually missing CAP_SYS_NICE / CAP_IPC_LOCK or a low RLIMIT_MEMLOCK).
+namespace rtThread
+{
+    struct region
+    {
+        void *p;
+        size_t bytes;
+    };
+
+    // Writes every page of the given regions so none of them faults later,
+    // then locks each one with mlock(). Only these regions are pinned; the rest
+    // of the process (file mappings, other threads' heaps) stays pageable.
+    // Each page's first byte is written back unchanged, so contents survive;
+    // call before any other thread writes the regions.
+    inline bool lockMemory(const region *regions, size_t n)
+    {
+#ifdef RT_THREAD_POSIX
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t touched = 0;
+        size_t locked = 0;
+        bool ok = true;
+        for (size_t i = 0; i < n; i++)
+        {
+            volatile unsigned char *p = static_cast<unsigned char *>(regions[i].p);
+            for (size_t off = 0; off < regions[i].bytes; off += page)
+            {
+                p[off] = p[off];
+            }
+            touched += regions[i].bytes;
+
+            if (mlock(regions[i].p, regions[i].bytes) != 0)
+            {
+                std::printf("RT: mlock of %zu KiB failed (%s); it is pre-faulted but can still be paged out.\n",
+                            regions[i].bytes / 1024, std::strerror(errno));
+                ok = false;
+            }
+            else
+            {
+                locked += regions[i].bytes;
+            }
+        }
+        std::printf("RT: pre-faulted %zu KiB of buffers, locked %zu KiB.\n", touched / 1024, locked / 1024);
+        return ok;
+#else
+        (void)regions;
+        (void)n;
+        std::printf("RT: memory locking not supported on this platform.\n");
+        return false;
+#endif
+    }
+
+    // Pins the calling thread to cpu (-1 leaves affinity alone) and moves it to
+    // SCHED_FIFO, or SCHED_RR if rr, at priority. Threads started afterwards
+    // inherit both, so call it once the other threads are running.
+    inline bool promote(int cpu, int priority, bool rr)
+    {
+        bool ok = true;
+#if defined(__linux__)
+        if (cpu >= 0)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            int e = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            if (e != 0)
+            {
+                std::printf("RT: could not pin to CPU %d (%s).\n", cpu, std::strerror(e));
+                ok = false;
+            }
+            else
+            {
+                std::printf("RT: pinned to CPU %d.\n", cpu);
+            }
+        }
+#else
+        if (cpu >= 0)
+        {
+            std::printf("RT: CPU pinning not supported on this platform.\n");
+            ok = false;
+        }
+#endif
+
+#ifdef RT_THREAD_POSIX
+        const int policy = rr ? SCHED_RR : SCHED_FIFO;
+        const char *name = rr ? "SCHED_RR" : "SCHED_FIFO";
+        sched_param sp{};
+        sp.sched_priority = std::max(sched_get_priority_min(policy), std::min(priority, sched_get_priority_max(policy)));
+        int e = pthread_setschedparam(pthread_self(), policy, &sp);
+        if (e != 0)
+        {
+            std::printf("RT: could not switch to %s %d (%s); staying at normal priority.\n", name, sp.sched_priority,
+                        std::strerror(e));
+            ok = false;
+        }
+        else
+        {
+            std::printf("RT: running %s at priority %d.\n", name, sp.sched_priority);
+        }
+#else
+        (void)priority;
+        (void)rr;
+        std::printf("RT: real-time scheduling not supported on this platform.\n");
+        ok = false;
+#endif
+        return ok;
+    }
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdlib>
+#define SAMPLE_HISTORY_MIRROR 1
+#else
+#include <vector>
+#endif
+
+// How fillGap() covers audio that never arrived.
+enum class concealMode
+{
+    silence, //zeros.
+    repeatLast, //the last period samples, repeated.
+    marker, //zeros, and windows overlapping them report !intact().
+};
+
+// Fixed-capacity float history with a contiguous view of the last N samples.
+// On POSIX the storage is mapped twice back to back, so a window that wraps
+// past the end of the buffer is still one contiguous span in memory.
+struct sampleHistory
+{
+    float *base = nullptr;
+    size_t cap = 0; //capacity in samples, power of two.
+    size_t mask = 0;
+    size_t written = 0; //ever-increasing; doubles as the sample timeline.
+    size_t cleanFrom = 0; //first sample after the last marker gap.
+
+    sampleHistory() = default;
+    sampleHistory(const sampleHistory &) = delete;
+    sampleHistory &operator=(const sampleHistory &) = delete;
+
+    ~sampleHistory()
+    {
+        release();
+    }
+
+    // Allocates room for at least maxSamples, rounded up to a power of two.
+    // Returns false if the mapping fails.
+    bool init(size_t maxSamples)
+    {
+        release();
+
+        size_t n = 1;
+        while (n < maxSamples)
+        {
+            n <<= 1;
+        }
+
+#ifdef SAMPLE_HISTORY_MIRROR
+        //Pages are a power of two too, so this keeps the size a page multiple.
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t bytes = std::max(n * sizeof(float), page);
+
+        int fd = makeBackingFile();
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        //Reserve 2x address space, then map the same pages into both halves.
+        void *area = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (area == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+
+        char *lo = static_cast<char *>(area);
+        void *a = mmap(lo, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        void *b = mmap(lo + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+        close(fd);
+
+        if (a == MAP_FAILED || b == MAP_FAILED)
+        {
+            munmap(area, 2 * bytes);
+            return false;
+        }
+
+        base = reinterpret_cast<float *>(lo);
+        cap = bytes / sizeof(float);
+#else
+        storage.assign(2 * n, 0.0f);
+        base = storage.data();
+        cap = n;
+#endif
+        mask = cap - 1;
+        written = 0;
+        cleanFrom = 0;
+        return true;
+    }
+
+    size_t capacity() const
+    {
+        return cap;
+    }
+
+    // Samples currently held; old ones fall off in O(1) once the window is full.
+    size_t size() const
+    {
+        return std::min(written, cap);
+    }
+
+    // Contiguous space for the next n samples (n <= capacity()); call advance(n)
+    // once filled, so producers can write in place instead of staging a copy.
+    float *writePtr()
+    {
+        return base + (written & mask);
+    }
+
+    void advance(size_t n)
+    {
+#ifndef SAMPLE_HISTORY_MIRROR
+        //The in-place write landed in [at, at + n); sync the other copy.
+        size_t at = written & mask;
+        size_t first = std::min(n, cap - at);
+        std::memcpy(base + cap + at, base + at, first * sizeof(float));
+        std::memcpy(base, base + cap, (n - first) * sizeof(float));
+#endif
+        written += n;
+    }
+
+    // Contiguous view of the most recent n samples (n <= size()), oldest first.
+    const float *latest(size_t n) const
+    {
+        return base + ((written - n) & mask);
+    }
+
+    // Stands in n samples for audio that was lost upstream, so positions after
+    // the gap keep their true distance from those before it.
+    void fillGap(size_t n, concealMode mode, size_t period)
+    {
+        //Past one capacity only the tail is still visible. Jump straight to it
+        //by whole capacities first, so the tail lands where the timeline puts
+        //it and the last period stays in place as the repeat's source.
+        size_t skip = n > cap ? (n - cap) / cap * cap : 0;
+        written += skip;
+        n -= skip;
+
+        if (mode == concealMode::repeatLast && period > 0 && written - skip >= period)
+        {
+            //A skipped stretch moved the repeat's phase on by skip % period.
+            size_t phase = skip % period;
+            if (phase != 0)
+            {
+                const float *last = latest(period);
+                float *dst = writePtr();
+                std::memcpy(dst, last + phase, (period - phase) * sizeof(float));
+                std::memcpy(dst + (period - phase), last, phase * sizeof(float));
+                advance(period);
+                n -= period;
+            }
+
+            //Each pass copies the period just written, so the repeat carries on.
+            while (n > 0)
+            {
+                size_t k = std::min(n, period);
+                std::memcpy(writePtr(), latest(period), k * sizeof(float));
+                advance(k);
+                n -= k;
+            }
+        }
+        else
+        {
+            while (n > 0)
+            {
+                size_t k = std::min(n, cap / 2);
+                std::fill(writePtr(), writePtr() + k, 0.0f);
+                advance(k);
+                n -= k;
+            }
+        }
+
+        if (mode == concealMode::marker)
+        {
+            cleanFrom = written;
+        }
+    }
+
+    // True if the most recent n samples contain no marker-concealed audio.
+    bool intact(size_t n) const
+    {
+        return intactSince(written - n);
+    }
+
+    // Same for everything from timeline position pos on.
+    bool intactSince(size_t pos) const
+    {
+        return pos >= cleanFrom;
+    }
+
+    // Contiguous view of n samples starting at timeline position pos; the span
+    // must still be held, i.e. written - size() <= pos and pos + n <= written.
+    const float *at(size_t pos) const
+    {
+        return base + (pos & mask);
+    }
+
+private:
+#ifdef SAMPLE_HISTORY_MIRROR
+    static int makeBackingFile()
+    {
+#if defined(__linux__)
+        int fd = memfd_create("sampleHistory", MFD_CLOEXEC);
+        if (fd >= 0)
+        {
+            return fd;
+        }
+#endif
+        char name[] = "/tmp/sampleHistory-XXXXXX";
+        int fd2 = mkstemp(name);
+        if (fd2 >= 0)
+        {
+            unlink(name);
+        }
+        return fd2;
+    }
+#else
+    std::vector<float> storage;
+#endif
+
+    void release()
+    {
+#ifdef SAMPLE_HISTORY_MIRROR
+        if (base != nullptr)
+        {
+            munmap(base, 2 * cap * sizeof(float));
+        }
+#endif
+        base = nullptr;
+        cap = 0;
+        mask = 0;
+        written = 0;
+        cleanFrom = 0;
+    }
+};
@@ -0,0 +1,462 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+constexpr unsigned long DEFAULT_FRAMES_PER_BLOCK = 512; //Previously opened.
+constexpr unsigned long MIN_FRAMES_PER_BLOCK = 64;
+constexpr unsigned long MAX_FRAMES_PER_BLOCK = 4096;
+
+// Element type of ring lanes, fixed by the stream's negotiated format.
+// 24-bit input is widened to left-justified int32 on the way in.
+enum class sampleType
+{
+    i16,
+    i32,
+    f32,
+};
+
+inline size_t sampleBytes(sampleType t)
+{
+    return t == sampleType::i16 ? sizeof(int16_t) : sizeof(int32_t);
+}
+
+// One audio block: a view of a ring slot, sized when the ring is set up.
+// Samples are planar: channel c occupies frames contiguous values at lane(c).
+struct Block
+{
+    void *samples = nullptr;
+    size_t frames = 0;
+    size_t channels = 1;
+    sampleType type = sampleType::i16;
+
+    //Capture metadata, stamped by the producer (broadcastRing) on the way in.
+    uint64_t seq = 0; //block number; counts dropped blocks too, so a jump marks a gap.
+    double adcTime = 0.0; //capture time of frame 0 on the source's stream clock, seconds.
+    uint32_t statusFlags = 0; //PaStreamCallbackFlags of the callbacks that fed this block, OR'ed.
+    uint32_t fill = 0; //blocks queued for the slowest reader when this one was published.
+
+    template <class T = int16_t>
+    T *lane(size_t c) { return static_cast<T *>(samples) + c * frames; }
+    template <class T = int16_t>
+    const T *lane(size_t c) const { return static_cast<const T *>(samples) + c * frames; }
+    // Lane c whatever the sample type, for type-dispatched kernels.
+    const void *rawLane(size_t c) const
+    {
+        return static_cast<const unsigned char *>(samples) + c * frames * sampleBytes(type);
+    }
+    size_t size() const { return frames; }
+    size_t bytes() const { return frames * channels * sampleBytes(type); }
+};
+
+// Sleep while word == expected, for at most timeout.
+inline void waitWord(std::atomic<uint32_t> &word, uint32_t expected, std::chrono::nanoseconds timeout)
+{
+#if defined(__linux__)
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain 32-bit word");
+    timespec ts{};
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+#else
+    //No futex: fall back to short polling naps.
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (word.load(std::memory_order_acquire) == expected && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+#endif
+}
+
+// Wake up to waiters threads sleeping on word.
+inline void wakeWord(std::atomic<uint32_t> &word, int waiters = 1)
+{
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, waiters, nullptr, nullptr, 0);
+#else
+    (void)word;
+    (void)waiters;
+#endif
+}
+
+constexpr size_t CACHE_LINE = 64;
+
+// What the producer does with a new block when the ring is full.
+enum class overflowPolicy
+{
+    dropNewest, //refuse the new block and count it in dropped; readers never see a gap mid-ring.
+    overwriteOldest, //reuse the oldest unread slot and count it in overwritten; readers skip stale audio.
+};
+
+// Slot sequence stamps: block i's slot holds 2i+1 while the producer rewrites
+// it and 2i+2 once committed. Counts how many of blocks [first, first + n)
+// were (even partly) overwritten since the reader's copy of them was made.
+inline size_t tornBlocks(const std::atomic<size_t> *seq, size_t mask, size_t first, size_t n)
+{
+    //Order the reader's loads of the slot contents before the stamp re-check.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    size_t bad = 0;
+    for (size_t k = 0; k < n; k++)
+    {
+        size_t i = first + k;
+        if (seq[i & mask].load(std::memory_order_relaxed) != 2 * i + 2)
+        {
+            ++bad;
+        }
+    }
+    return bad;
+}
+
+// Producer side of the stamp protocol, around filling block wi's slot.
+inline void stampWriting(std::atomic<size_t> *seq, size_t mask, size_t wi)
+{
+    seq[wi & mask].store(2 * wi + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); //stamp lands before any slot write.
+}
+
+inline void stampCommitted(std::atomic<size_t> *seq, size_t mask, size_t wi)
+{
+    seq[wi & mask].store(2 * wi + 2, std::memory_order_release);
+}
+
+// Ready blocks handed out by peekBatch(): up to two contiguous runs of ring
+// slots, the second one starting at slot 0 when the batch wraps.
+struct blockSpan
+{
+    const Block *first = nullptr;
+    size_t n1 = 0;
+    const Block *second = nullptr;
+    size_t n2 = 0;
+
+    size_t size() const { return n1 + n2; }
+    const Block &operator[](size_t i) const { return i < n1 ? first[i] : second[i - n1]; }
+};
+
+// Slot storage and the stamp protocol, shared by spscRing and broadcastRing:
+// cap slots of frames x channels planar samples, each with a sequence stamp.
+// The rings add their own indices and decide when a slot may be reused.
+struct ringSlots
+{
+    //Set by initSlots(), read-only once the stream starts.
+    size_t cap = 0; //slots, power of two.
+    size_t mask = 0;
+    size_t frames = 0; //frames per slot.
+    size_t channels = 1;
+    sampleType type = sampleType::i16;
+    overflowPolicy policy = overflowPolicy::dropNewest;
+    std::vector<unsigned char> storage; //all slots, back to back.
+    std::vector<Block> buf;
+    std::unique_ptr<std::atomic<size_t>[]> seq; //per-slot stamps, see tornBlocks().
+
+    // Carves storage into slots of framesPerBlock frames of nChannels planar
+    // lanes of sample type t. Slot count grows for small blocks to keep ~0.7 s
+    // of slack, rounded up to a power of two.
+    void initSlots(size_t framesPerBlock, size_t nChannels, sampleType t, overflowPolicy p)
+    {
+        frames = framesPerBlock;
+        channels = nChannels;
+        type = t;
+        policy = p;
+        size_t want = std::max<size_t>(64, 32768 / framesPerBlock);
+        cap = 1;
+        while (cap < want)
+        {
+            cap <<= 1;
+        }
+        mask = cap - 1;
+        storage.assign(cap * slotBytes(), 0);
+        buf.resize(cap);
+        for (size_t i = 0; i < cap; i++)
+        {
+            buf[i].samples = storage.data() + i * slotBytes();
+            buf[i].frames = frames;
+            buf[i].channels = channels;
+            buf[i].type = type;
+        }
+        seq.reset(new std::atomic<size_t>[cap]);
+        for (size_t i = 0; i < cap; i++)
+        {
+            seq[i].store(0);
+        }
+    }
+
+    size_t slotBytes() const
+    {
+        return frames * channels * sampleBytes(type);
+    }
+
+    // Producer: stamp block wi's slot as being rewritten and hand it out. The
+    // slot points at its own storage; a producer may instead point samples at
+    // read-only memory that outlives the readers' use of the block (see fileSource).
+    Block &beginWrite(size_t wi)
+    {
+        size_t i = wi & mask;
+        stampWriting(seq.get(), mask, wi);
+        buf[i].samples = storage.data() + i * slotBytes();
+        return buf[i];
+    }
+
+    // Producer: block wi's slot is complete; publish the index after this.
+    void endWrite(size_t wi)
+    {
+        stampCommitted(seq.get(), mask, wi);
+    }
+
+    // Consumer: n ready slots from index ri as one or two contiguous spans.
+    blockSpan span(size_t ri, size_t n) const
+    {
+        size_t at = ri & mask;
+        blockSpan out;
+        out.first = &buf[at];
+        out.n1 = std::min(n, cap - at);
+        out.second = buf.data();
+        out.n2 = n - out.n1;
+        return out;
+    }
+
+    // Consumer: true while block i's slot still holds block i, complete. Check
+    // it before trusting a slot's contents and again after reading them.
+    bool intact(size_t i) const
+    {
+        return tornIn(i, 1) == 0;
+    }
+
+    // Consumer: how many of blocks [ri, ri + n) were overwritten while held;
+    // always 0 under dropNewest, where the producer never laps a reader.
+    size_t tornIn(size_t ri, size_t n) const
+    {
+        return policy == overflowPolicy::overwriteOldest ? tornBlocks(seq.get(), mask, ri, n) : 0;
+    }
+};
+
+// Futex parking for ring consumers, on its own cache line.
+struct ringWake
+{
+    alignas(CACHE_LINE) std::atomic<uint32_t> wakeSeq{0}; //futex word, bumped on each wakeup.
+    std::atomic<uint32_t> parked{0}; //consumers currently asleep in wait().
+    char pad[CACHE_LINE - 2 * sizeof(std::atomic<uint32_t>)]; //keep neighbours off this line.
+
+    // Consumer: sleep until ready() or the timeout. ready() is re-checked
+    // after announcing the park, so a publish racing with us is not missed.
+    template <class F>
+    bool wait(F &&ready, std::chrono::nanoseconds timeout)
+    {
+        uint32_t ticket = wakeSeq.load(std::memory_order_acquire);
+        parked.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        bool ok = ready();
+        if (!ok)
+        {
+            waitWord(wakeSeq, ticket, timeout);
+            ok = ready();
+        }
+        parked.fetch_sub(1, std::memory_order_relaxed);
+        return ok;
+    }
+
+    // Producer, after publishing: only touches the futex when someone is parked.
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_relaxed) != 0)
+        {
+            wakeAll();
+        }
+    }
+
+    // Kick every parked consumer without publishing, e.g. at end of stream.
+    void wakeAll()
+    {
+        wakeSeq.fetch_add(1, std::memory_order_release);
+        wakeWord(wakeSeq, INT_MAX);
+    }
+};
+
+// Minimal SPSC ring buffer.
+// Producer and consumer state live on separate cache lines, and each side
+// keeps a cached copy of the other's index, reloading it only when the ring
+// looks full (producer) or empty (consumer). Under overwriteOldest the
+// consumer checks slot stamps on release() to catch blocks lapped mid-read.
+struct spscRing : ringSlots
+{
+    //Producer-owned.
+    alignas(CACHE_LINE) std::atomic<size_t> w{0}; //ever-increasing.
+    size_t rCache = 0; //producer's last look at r.
+    std::atomic<size_t> dropped{0}; //new blocks refused (dropNewest).
+    std::atomic<size_t> overwritten{0}; //unread blocks reused (overwriteOldest).
+
+    //Consumer-owned.
+    alignas(CACHE_LINE) std::atomic<size_t> r{0}; //ever-increasing.
+    size_t wCache = 0; //consumer's last look at w.
+    std::atomic<size_t> torn{0}; //blocks overwritten while the consumer held them.
+
+    ringWake wake;
+
+    // Must run before the stream starts; see ringSlots::initSlots().
+    void init(size_t framesPerBlock, size_t nChannels = 1, sampleType t = sampleType::i16,
+              overflowPolicy p = overflowPolicy::dropNewest)
+    {
+        initSlots(framesPerBlock, nChannels, t, p);
+        w.store(0);
+        r.store(0);
+        rCache = 0;
+        wCache = 0;
+        dropped.store(0);
+        overwritten.store(0);
+        torn.store(0);
+    }
+
+    // Producer: reserve the next slot so the caller can fill it in place.
+    // When the ring is full, dropNewest returns nullptr (and counts a drop);
+    // overwriteOldest hands out the oldest unread slot (and counts it).
+    Block *claim()
+    {
+        size_t wi = w.load(std::memory_order_relaxed);
+
+        if (full())
+        {
+            if (policy == overflowPolicy::dropNewest)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            overwritten.fetch_add(1, std::memory_order_relaxed);
+        }
+        return &beginWrite(wi);
+    }
+
+    // Producer: publish the slot handed out by the last claim().
+    void commit()
+    {
+        size_t wi = w.load(std::memory_order_relaxed);
+        endWrite(wi);
+        w.store(wi + 1, std::memory_order_release);
+        wake.notify();
+    }
+
+    // Producer: true if the consumer is a whole ring behind.
+    bool full()
+    {
+        size_t wi = w.load(std::memory_order_relaxed);
+        if (wi - rCache >= cap)
+        {
+            rCache = r.load(std::memory_order_acquire);
+        }
+        return wi - rCache >= cap;
+    }
+
+    // Kick a parked consumer without publishing a slot, e.g. at end of stream.
+    void wakeConsumer()
+    {
+        wake.wakeAll();
+    }
+
+    // Consumer: look at the oldest ready slot without copying it out.
+    // The pointer stays valid until release().
+    const Block *peek()
+    {
+        if (ready() == 0)
+        {
+            return nullptr;
+        }
+
+        return &buf[r.load(std::memory_order_relaxed) & mask];
+    }
+
+    // Consumer: hand the slot returned by peek() back to the producer. Returns
+    // false if it was overwritten while held, i.e. what was read is garbage.
+    bool release()
+    {
+        return releaseBatch(1) == 0;
+    }
+
+    // Consumer: up to maxBlocks ready slots in one go, valid until releaseBatch().
+    blockSpan peekBatch(size_t maxBlocks)
+    {
+        size_t n = std::min(ready(), maxBlocks);
+        return span(r.load(std::memory_order_relaxed), n);
+    }
+
+    // Consumer: hand back n slots from peekBatch() with a single index store.
+    // Returns how many of them were overwritten while held (overwriteOldest).
+    size_t releaseBatch(size_t n)
+    {
+        size_t ri = r.load(std::memory_order_relaxed);
+        size_t bad = tornIn(ri, n);
+        torn.fetch_add(bad, std::memory_order_relaxed);
+        r.store(ri + n, std::memory_order_release);
+        return bad;
+    }
+
+    // Consumer: block until a slot is ready or the timeout expires.
+    // Returns true if peek() will succeed.
+    bool waitFor(std::chrono::nanoseconds timeout)
+    {
+        return wake.wait([this] { return w.load(std::memory_order_acquire) != r.load(std::memory_order_relaxed); },
+                         timeout);
+    }
+
+    // Copying wrappers: src/out hold one planar block.
+    bool push(const void *src)
+    {
+        Block *slot = claim();
+        if (slot == nullptr)
+        {
+            return false;
+        }
+
+        std::memcpy(slot->samples, src, slotBytes());
+        commit();
+        return true;
+    }
+
+    // Skips blocks found torn after the copy; false only when the ring is empty.
+    bool pop(void *out)
+    {
+        while (const Block *slot = peek())
+        {
+            std::memcpy(out, slot->samples, slotBytes());
+            if (release())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    // Blocks ready to read. Under overwriteOldest, a consumer more than a ring
+    // behind first jumps to the oldest block that can still be intact; the
+    // producer already counted the skipped ones as overwritten.
+    size_t ready()
+    {
+        size_t ri = r.load(std::memory_order_relaxed);
+        if (ri == wCache)
+        {
+            wCache = w.load(std::memory_order_acquire);
+        }
+
+        if (policy == overflowPolicy::overwriteOldest && wCache - ri > cap)
+        {
+            ri = wCache - cap;
+            r.store(ri, std::memory_order_release);
+        }
+        return wCache - ri;
+    }
+};
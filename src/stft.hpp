@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "fft.hpp"
+#include "sampleHistory.hpp"
+
+enum class windowType
+{
+    hann,
+    hamming,
+    blackmanHarris, //4-term, -92 dB sidelobes.
+};
+
+// One analysed frame; the pointers are valid until the next frame.
+struct stftFrame
+{
+    size_t start; //timeline position (sampleHistory::written) of the first sample.
+    size_t bins; //nfft/2 + 1
+    const float *re;
+    const float *im;
+    const float *power; //re^2 + im^2
+};
+
+// Short-time Fourier transform over a sampleHistory. Frames sit on a fixed
+// hop grid on the history's timeline, independent of the capture block size;
+// update() analyses every frame that has become complete since the last call,
+// reading the window straight out of the history's contiguous view.
+struct stft
+{
+    size_t win = 0; //window length, samples.
+    size_t hop = 0;
+    size_t nfft = 0; //window zero-padded to this.
+    windowType type = windowType::hann;
+    realFft *plan = nullptr;
+    std::vector<float> window; //precomputed by init().
+    std::vector<float> frame, re, im, power;
+
+    size_t nextStart = 0; //timeline position of the next frame.
+    size_t produced = 0;
+    size_t skipped = 0; //frames dropped for overlapping a marker gap or falling out of the history.
+
+    // fftSize 0 picks the smallest supported size >= winLen. Returns false if
+    // the sizes are unusable.
+    bool init(size_t winLen, size_t hopLen, windowType w, size_t fftSize = 0)
+    {
+        if (winLen < 4 || hopLen == 0)
+        {
+            return false;
+        }
+
+        nfft = fftSize != 0 ? fftSize : winLen;
+        while (fftSize == 0 && !realFft::supported(nfft))
+        {
+            ++nfft;
+        }
+        if (nfft < winLen || (plan = fft::plan(nfft)) == nullptr)
+        {
+            return false;
+        }
+
+        win = winLen;
+        hop = hopLen;
+        type = w;
+
+        //Periodic windows, so overlapping frames at hop = win/2 (Hann) sum flat.
+        window.resize(win);
+        for (size_t i = 0; i < win; i++)
+        {
+            double x = 2.0 * fft::PI * static_cast<double>(i) / static_cast<double>(win);
+            double v = 0.0;
+            switch (type)
+            {
+            case windowType::hann: v = 0.5 - 0.5 * std::cos(x); break;
+            case windowType::hamming: v = 0.54 - 0.46 * std::cos(x); break;
+            case windowType::blackmanHarris:
+                v = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+                break;
+            }
+            window[i] = static_cast<float>(v);
+        }
+
+        frame.assign(nfft, 0.0f);
+        re.assign(nfft / 2 + 1, 0.0f);
+        im.assign(nfft / 2 + 1, 0.0f);
+        power.assign(nfft / 2 + 1, 0.0f);
+        nextStart = 0;
+        produced = 0;
+        skipped = 0;
+        return true;
+    }
+
+    size_t bins() const
+    {
+        return nfft / 2 + 1;
+    }
+
+    // Runs onFrame(const stftFrame &) for every frame now complete in h.
+    // Returns how many frames were analysed.
+    template <class F>
+    size_t update(const sampleHistory &h, F &&onFrame)
+    {
+        size_t n = 0;
+
+        //Frames whose start has already left the history are gone; stay on the hop grid.
+        size_t oldest = h.written - h.size();
+        if (nextStart < oldest)
+        {
+            size_t lost = (oldest - nextStart + hop - 1) / hop;
+            skipped += lost;
+            nextStart += lost * hop;
+        }
+
+        for (; nextStart + win <= h.written; nextStart += hop)
+        {
+            if (!h.intactSince(nextStart))
+            {
+                ++skipped;
+                continue;
+            }
+
+            const float *x = h.at(nextStart);
+            for (size_t i = 0; i < win; i++)
+            {
+                frame[i] = x[i] * window[i];
+            }
+            plan->forward(frame.data(), re.data(), im.data());
+            for (size_t k = 0; k < re.size(); k++)
+            {
+                power[k] = re[k] * re[k] + im[k] * im[k];
+            }
+
+            ++produced;
+            ++n;
+            onFrame(stftFrame{nextStart, re.size(), re.data(), im.data(), power.data()});
+        }
+        return n;
+    }
+};